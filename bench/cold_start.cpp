@@ -0,0 +1,237 @@
+#include "main_entry_probe.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <elf.h>
+#include <fcntl.h>
+#include <optional>
+#include <spawn.h>
+#include <string>
+#include <string_view>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <vector>
+
+/* `cold_start_bench` measures the cost of starting a short-lived process that parses its
+command-line arguments: the time from `posix_spawn` until the process has exited, the number of
+minor page faults it incurred, the time until it entered `main` (for binaries that report it;
+see main_entry_probe.h), and the size of its `.text` section.
+
+Usage: cold_start_bench [--runs N] [--baseline EMPTY_MAIN] TARGET [ARGS...]
+
+If no `ARGS` are given, a representative set of arguments is used. If `--baseline` is given,
+the baseline binary is measured as well, and the difference between the time-to-`main` of the
+target and that of the baseline is reported as the target's static initialization time (this
+includes the cost of dynamically linking any libraries the baseline does not link, such as the
+C++ standard library). */
+
+extern char **environ;
+
+using namespace std::literals;
+
+namespace {
+
+/* Arguments passed to the target when none are given on the command line */
+const std::vector<std::string> representative_arguments = {
+    "--nthreads", "8", "--spp=256", "-s", "42", "--imagefile=render.ppm", "--input",
+    "scene.txt", "-qp"
+};
+
+struct RunResult {
+    double wall_microseconds;
+    long minor_faults;
+    std::optional<double> exec_to_main_microseconds;
+};
+
+auto to_microseconds(const timespec &t) -> double {
+    return static_cast<double>(t.tv_sec) * 1e6 + static_cast<double>(t.tv_nsec) / 1e3;
+}
+
+auto now() -> timespec {
+    timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t;
+}
+
+[[noreturn]] void fail(const char *what) {
+    std::perror(what);
+    std::exit(1);
+}
+
+/* Spawns `argv[0]` with the arguments `argv` (with `stdout` and `stderr` redirected to
+/dev/null), waits for it to exit, and returns its measurements. */
+auto run_once(const std::vector<char *> &argv) -> RunResult {
+    int probe_pipe[2];
+    if (pipe(probe_pipe) != 0) {
+        fail("pipe");
+    }
+
+    posix_spawn_file_actions_t file_actions;
+    posix_spawn_file_actions_init(&file_actions);
+    posix_spawn_file_actions_addopen(&file_actions, STDOUT_FILENO, "/dev/null", O_WRONLY, 0);
+    posix_spawn_file_actions_addopen(&file_actions, STDERR_FILENO, "/dev/null", O_WRONLY, 0);
+    /* Close the read end before `dup2`ing the write end, since the read end may itself be
+    `main_entry_probe_fd` */
+    posix_spawn_file_actions_addclose(&file_actions, probe_pipe[0]);
+    posix_spawn_file_actions_adddup2(&file_actions, probe_pipe[1], main_entry_probe_fd);
+
+    auto start = now();
+    pid_t pid;
+    if (posix_spawn(&pid, argv[0], &file_actions, nullptr, argv.data(), environ) != 0) {
+        fail("posix_spawn");
+    }
+    int status;
+    rusage usage;
+    if (wait4(pid, &status, 0, &usage) != pid) {
+        fail("wait4");
+    }
+    auto end = now();
+
+    posix_spawn_file_actions_destroy(&file_actions);
+    close(probe_pipe[1]);
+
+    RunResult result{to_microseconds(end) - to_microseconds(start), usage.ru_minflt, std::nullopt};
+    if (timespec main_entry;
+        read(probe_pipe[0], &main_entry, sizeof(main_entry)) == sizeof(main_entry)) {
+        result.exec_to_main_microseconds = to_microseconds(main_entry) - to_microseconds(start);
+    }
+    close(probe_pipe[0]);
+
+    return result;
+}
+
+/* Returns the `p`th percentile (0 <= p <= 100) of `values` */
+template <typename T>
+auto percentile(std::vector<T> values, double p) -> T {
+    auto index = static_cast<std::size_t>(p / 100.0 * static_cast<double>(values.size() - 1) + 0.5);
+    auto nth = values.begin() + static_cast<std::ptrdiff_t>(index);
+    std::nth_element(values.begin(), nth, values.end());
+    return values[index];
+}
+
+/* Returns the size of the `.text` section of the 64-bit ELF file at `path`, or `std::nullopt`
+if it could not be determined. */
+auto text_section_size(const char *path) -> std::optional<std::uint64_t> {
+    auto file = std::fopen(path, "rb");
+    if (!file) {
+        return std::nullopt;
+    }
+
+    std::optional<std::uint64_t> size;
+    Elf64_Ehdr header;
+    if (std::fread(&header, sizeof(header), 1, file) == 1 &&
+        std::memcmp(header.e_ident, ELFMAG, SELFMAG) == 0 &&
+        header.e_ident[EI_CLASS] == ELFCLASS64) {
+
+        /* Read the section headers, then the section name string table */
+        std::vector<Elf64_Shdr> sections(header.e_shnum);
+        std::fseek(file, static_cast<long>(header.e_shoff), SEEK_SET);
+        auto sections_read = std::fread(sections.data(), sizeof(Elf64_Shdr), sections.size(), file);
+        if (sections_read == sections.size() &&
+            header.e_shstrndx < sections.size()) {
+
+            auto &names_section = sections[header.e_shstrndx];
+            std::string names(names_section.sh_size, '\0');
+            std::fseek(file, static_cast<long>(names_section.sh_offset), SEEK_SET);
+            if (std::fread(names.data(), 1, names.size(), file) == names.size()) {
+                for (auto &section : sections) {
+                    if (section.sh_name < names.size() &&
+                        names.c_str() + section.sh_name == ".text"sv) {
+                        size = section.sh_size;
+                    }
+                }
+            }
+        }
+    }
+
+    std::fclose(file);
+    return size;
+}
+
+/* Measures `runs` spawns of `argv[0]` and prints a summary. Returns the median time-to-`main`,
+if the binary reported one. */
+auto measure(const char *label, std::vector<char *> argv, int runs) -> std::optional<double> {
+    argv.push_back(nullptr);
+
+    /* Warm up the page cache, so that the first measured run does not include disk reads */
+    run_once(argv);
+
+    std::vector<double> wall, exec_to_main;
+    std::vector<long> minor_faults;
+    for (int i = 0; i < runs; ++i) {
+        auto result = run_once(argv);
+        wall.push_back(result.wall_microseconds);
+        minor_faults.push_back(result.minor_faults);
+        if (result.exec_to_main_microseconds) {
+            exec_to_main.push_back(*result.exec_to_main_microseconds);
+        }
+    }
+
+    std::printf("%s: %s\n", label, argv[0]);
+    std::printf("    wall_us: p50=%.1f p99=%.1f\n", percentile(wall, 50), percentile(wall, 99));
+    std::printf(
+        "    minor_faults: p50=%ld p99=%ld\n",
+        percentile(minor_faults, 50), percentile(minor_faults, 99)
+    );
+    std::optional<double> median_exec_to_main;
+    if (exec_to_main.size() == wall.size()) {
+        median_exec_to_main = percentile(exec_to_main, 50);
+        std::printf(
+            "    exec_to_main_us: p50=%.1f p99=%.1f\n",
+            *median_exec_to_main, percentile(exec_to_main, 99)
+        );
+    }
+    if (auto size = text_section_size(argv[0])) {
+        std::printf("    text_bytes: %llu\n", static_cast<unsigned long long>(*size));
+    }
+
+    return median_exec_to_main;
+}
+
+}
+
+int main(int argc, char **argv)
+{
+    int runs = 200;
+    const char *baseline = nullptr;
+
+    int i = 1;
+    for (; i < argc && argv[i][0] == '-'; ++i) {
+        if (argv[i] == "--runs"sv && i + 1 < argc) {
+            runs = std::max(1, std::atoi(argv[++i]));
+        } else if (argv[i] == "--baseline"sv && i + 1 < argc) {
+            baseline = argv[++i];
+        } else {
+            break;
+        }
+    }
+    if (i >= argc) {
+        std::fprintf(
+            stderr, "Usage: %s [--runs N] [--baseline EMPTY_MAIN] TARGET [ARGS...]\n", argv[0]
+        );
+        return 1;
+    }
+
+    /* Build the target's argv, using the representative arguments if none were given */
+    std::vector<char *> target_argv(argv + i, argv + argc);
+    if (target_argv.size() == 1) {
+        for (auto &argument : representative_arguments) {
+            target_argv.push_back(const_cast<char *>(argument.c_str()));
+        }
+    }
+
+    auto target_exec_to_main = measure("target", target_argv, runs);
+    if (baseline) {
+        auto baseline_exec_to_main = measure("baseline", {const_cast<char *>(baseline)}, runs);
+        if (target_exec_to_main && baseline_exec_to_main) {
+            std::printf(
+                "static_init_us (target exec_to_main p50 - baseline exec_to_main p50): %.1f\n",
+                *target_exec_to_main - *baseline_exec_to_main
+            );
+        }
+    }
+
+    return 0;
+}
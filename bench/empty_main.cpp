@@ -0,0 +1,10 @@
+#include "main_entry_probe.h"
+
+/* A program that does nothing, for use as the baseline of `cold_start_bench`. Since it does not
+link the parser (or `<iostream>`, or `<format>`), the difference between its time-to-`main` and
+that of another benchmark binary estimates the other binary's static initialization cost. */
+int main()
+{
+    report_main_entry();
+    return 0;
+}
@@ -0,0 +1,127 @@
+#include "getopt_compat.h"
+#include <chrono>
+#include <cstdio>
+#include <getopt.h>
+#include <string>
+#include <vector>
+
+/* `getopt_bench` compares `cap_getopt_long` (include/getopt_compat.h) against glibc's
+`getopt_long` on the same option table and arguments, across several argument counts. For each
+count, it reports the average time to process one whole `argv`, and the time per argument.
+
+Usage: getopt_bench [TOTAL_ARGUMENTS_PER_MEASUREMENT] */
+
+namespace {
+
+/* A table of the size typical of a C command-line tool */
+const option long_options[] = {
+    {"verbose", no_argument, nullptr, 'v'},
+    {"quiet", no_argument, nullptr, 'q'},
+    {"nthreads", required_argument, nullptr, 'n'},
+    {"spp", required_argument, nullptr, 's'},
+    {"seed", required_argument, nullptr, 'S'},
+    {"imagefile", required_argument, nullptr, 'o'},
+    {"input", required_argument, nullptr, 'i'},
+    {"partial", no_argument, nullptr, 'p'},
+    {"logutil", no_argument, nullptr, 'l'},
+    {"width", required_argument, nullptr, 'w'},
+    {"height", required_argument, nullptr, 'h'},
+    {"max-depth", required_argument, nullptr, 'd'},
+    {"tile-size", required_argument, nullptr, 't'},
+    {"denoise", optional_argument, nullptr, 'D'},
+    {"exposure", required_argument, nullptr, 'e'},
+    {"gamma", required_argument, nullptr, 'g'},
+    {"format", required_argument, nullptr, 'f'},
+    {"background", required_argument, nullptr, 'b'},
+    {"no-cache", no_argument, nullptr, 'C'},
+    {"help", no_argument, nullptr, 'H'},
+    {nullptr, 0, nullptr, 0}
+};
+const char short_options[] = "vqn:s:S:o:i:plw:h:d:t:D::e:g:f:b:CH";
+
+/* Arguments cycled through to build an `argv` of any length; these cover long options with
+attached and separate values, abbreviations, attached short values, short option clusters, and
+non-options (which `getopt_long` permutes to the end). */
+const std::vector<std::vector<const char *>> argument_groups = {
+    {"--nthreads=8"}, {"--spp", "256"}, {"-n5"}, {"-qv"}, {"--imagefile=render.ppm"},
+    {"--input", "scene.txt"}, {"--max-d=12"}, {"-t", "32"}, {"--denoise"}, {"scene_part.obj"},
+    {"--exposure=1.5"}, {"-pl"}, {"--no-cache"}, {"--gamma", "2.2"}
+};
+
+auto make_arguments(int count) -> std::vector<std::string> {
+    std::vector<std::string> arguments{"getopt_bench"};
+    for (std::size_t i = 0; static_cast<int>(arguments.size()) <= count; ++i) {
+        for (auto argument : argument_groups[i % argument_groups.size()]) {
+            arguments.emplace_back(argument);
+        }
+    }
+    return arguments;
+}
+
+/* Returns the average number of nanoseconds `parse` takes to process all of `arguments`, over
+`repetitions` runs. `argv` is rebuilt before each run, because both parsers permute it. */
+template <typename Parse>
+auto time_parser(
+    const std::vector<std::string> &arguments,
+    long repetitions,
+    Parse parse
+) -> double {
+    std::vector<char *> argv(arguments.size() + 1);
+    long checksum = 0;
+    std::chrono::steady_clock::duration elapsed{};
+    for (long r = 0; r < repetitions; ++r) {
+        for (std::size_t i = 0; i < arguments.size(); ++i) {
+            argv[i] = const_cast<char *>(arguments[i].c_str());
+        }
+        auto start = std::chrono::steady_clock::now();
+        checksum += parse(static_cast<int>(arguments.size()), argv.data());
+        elapsed += std::chrono::steady_clock::now() - start;
+    }
+    if (checksum == 0) {
+        std::puts("(no options were parsed)");
+    }
+    auto elapsed_ns = std::chrono::duration<double, std::nano>(elapsed).count();
+    return elapsed_ns / static_cast<double>(repetitions);
+}
+
+}
+
+int main(int argc, char **argv)
+{
+    long total_arguments = argc > 1 ? std::atol(argv[1]) : 10'000'000;
+
+    std::printf(
+        "%9s %16s %16s %14s %14s\n",
+        "arguments", "glibc_ns/argv", "cap_ns/argv", "glibc_ns/arg", "cap_ns/arg"
+    );
+    for (int count : {10, 100, 1000, 10000, 100000}) {
+        auto arguments = make_arguments(count);
+        auto repetitions = std::max(1L, total_arguments / static_cast<long>(arguments.size()));
+
+        auto glibc = time_parser(arguments, repetitions, [](int argc, char **argv) {
+            long options_parsed = 0;
+            optind = 0;
+            opterr = 0;
+            while (getopt_long(argc, argv, short_options, long_options, nullptr) != -1) {
+                ++options_parsed;
+            }
+            return options_parsed;
+        });
+        auto cap = time_parser(arguments, repetitions, [](int argc, char **argv) {
+            long options_parsed = 0;
+            cap_optind = 0;
+            cap_opterr = 0;
+            auto table = reinterpret_cast<const cap_option *>(long_options);
+            while (cap_getopt_long(argc, argv, short_options, table, nullptr) != -1) {
+                ++options_parsed;
+            }
+            return options_parsed;
+        });
+
+        auto n = static_cast<double>(arguments.size());
+        std::printf(
+            "%9zu %16.0f %16.0f %14.1f %14.1f\n", arguments.size(), glibc, cap, glibc / n, cap / n
+        );
+    }
+    return 0;
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+#include <ctime>
+#include <unistd.h>
+
+/* The file descriptor on which `cold_start_bench` listens for the time at which the spawned
+process entered `main`. It is only open in processes spawned by `cold_start_bench`. */
+inline constexpr int main_entry_probe_fd = 3;
+
+/* Writes the current `CLOCK_MONOTONIC` time to `main_entry_probe_fd`, if that file descriptor is
+open. Benchmark binaries call this first thing in `main`, so that `cold_start_bench` can split
+the time from `posix_spawn` to exit into the time before `main` (executable loading, dynamic
+linking, and static initialization) and the time spent in `main` itself. */
+inline void report_main_entry() {
+    timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    [[maybe_unused]] auto written = write(main_entry_probe_fd, &now, sizeof(now));
+    close(main_entry_probe_fd);
+}
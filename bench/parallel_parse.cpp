@@ -0,0 +1,63 @@
+#include "argumentparser.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+/* `parallel_parse` constructs `CommandLineOptions` from a very large number of arguments (as
+generated from response files), and reports the time per argument. Build it with and without the
+`CPP_ARGUMENT_PARSER_PARALLEL_PARSE` option to compare parallel and sequential parsing.
+
+Usage: parallel_parse [NUM_ARGUMENTS] [ITERATIONS] */
+
+namespace {
+
+/* The arguments are repetitions of this sequence, which mixes options with separate values,
+options with values after an equals sign, and clusters of boolean options */
+const char *argument_pattern[] = {
+    "--nthreads", "8", "--spp=256", "-s", "42", "--imagefile=render.ppm", "--input", "scene.txt",
+    "-qp", "--partial=false", "--logutil"
+};
+constexpr std::size_t argument_pattern_size =
+    sizeof(argument_pattern) / sizeof(argument_pattern[0]);
+
+}
+
+int main(int argc, char **argv)
+{
+    std::size_t num_arguments = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 500'000;
+
+    /* Round the number of arguments up to a whole number of repetitions of the pattern, so that
+    the last option is never missing its value */
+    num_arguments = (num_arguments + argument_pattern_size - 1) / argument_pattern_size *
+        argument_pattern_size;
+    long iterations = argc > 2 ? std::atol(argv[2]) : 20;
+
+    std::vector<std::string> arguments;
+    arguments.reserve(num_arguments);
+    arguments.emplace_back("parallel_parse");
+    while (arguments.size() < num_arguments + 1) {
+        arguments.emplace_back(argument_pattern[(arguments.size() - 1) % argument_pattern_size]);
+    }
+    std::vector<char *> large_argv;
+    for (auto &argument : arguments) {
+        large_argv.push_back(argument.data());
+    }
+
+    long checksum = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (long i = 0; i < iterations; ++i) {
+        CommandLineOptions options(static_cast<int>(large_argv.size()), large_argv.data());
+        checksum += options.nthreads + options.spp + options.quiet;
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+
+    auto nanoseconds = std::chrono::duration<double, std::nano>(elapsed).count();
+    std::printf(
+        "%zu arguments: %.2f ms/parse, %.2f ns/argument (checksum %ld)\n",
+        num_arguments, nanoseconds / static_cast<double>(iterations) / 1e6,
+        nanoseconds / static_cast<double>(iterations * static_cast<long>(num_arguments)), checksum
+    );
+    return 0;
+}
@@ -0,0 +1,13 @@
+#include "argumentparser.h"
+#include "main_entry_probe.h"
+
+/* A minimal program that only parses its command-line arguments, for use with
+`cold_start_bench`. Unlike src/main.cpp, it does not format or print the parsed options, so
+that the measured cost is that of loading and running the parser alone. */
+int main(int argc, char **argv)
+{
+    report_main_entry();
+
+    CommandLineOptions options(argc, argv);
+    return 0;
+}
@@ -0,0 +1,45 @@
+#include "argumentparser.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+
+/* `parse_throughput` constructs `CommandLineOptions` from a representative set of arguments many
+times in a loop, and reports the average time per parse. Build it with and without the
+`CPP_ARGUMENT_PARSER_COMPACT_DISPATCH` option to compare the two dispatch modes.
+
+Usage: parse_throughput [ITERATIONS] */
+
+namespace {
+
+char executable[] = "parse_throughput";
+char *representative_argv[] = {
+    executable, const_cast<char *>("--nthreads"), const_cast<char *>("8"),
+    const_cast<char *>("--spp=256"), const_cast<char *>("-s"), const_cast<char *>("42"),
+    const_cast<char *>("--imagefile=render.ppm"), const_cast<char *>("--input"),
+    const_cast<char *>("scene.txt"), const_cast<char *>("-qp"),
+    const_cast<char *>("--partial=false")
+};
+constexpr int representative_argc = sizeof(representative_argv) / sizeof(representative_argv[0]);
+
+}
+
+int main(int argc, char **argv)
+{
+    long iterations = argc > 1 ? std::atol(argv[1]) : 1'000'000;
+
+    int checksum = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (long i = 0; i < iterations; ++i) {
+        CommandLineOptions options(representative_argc, representative_argv);
+        checksum += options.nthreads + options.spp + options.quiet;
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+
+    auto nanoseconds = std::chrono::duration<double, std::nano>(elapsed).count();
+    std::printf(
+        "%ld parses: %.1f ns/parse (%.0f parses/s, checksum %d)\n",
+        iterations, nanoseconds / static_cast<double>(iterations),
+        static_cast<double>(iterations) / nanoseconds * 1e9, checksum
+    );
+    return 0;
+}
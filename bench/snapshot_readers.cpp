@@ -0,0 +1,78 @@
+#include "optionssnapshot.h"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/* `snapshot_readers` measures the cost of reading a few hot options (`spp`, `seed`, and `quiet`)
+from many threads at once, through a mutex-guarded global copy of `CommandLineOptions`, and
+through `current_options()`.
+
+Usage: snapshot_readers [THREADS] [READS_PER_THREAD] */
+
+namespace {
+
+char executable[] = "snapshot_readers";
+char *representative_argv[] = {
+    executable, const_cast<char *>("--spp=256"), const_cast<char *>("--seed=42"),
+    const_cast<char *>("-q")
+};
+
+/* The mutex-guarded global copy */
+std::mutex options_mutex;
+CommandLineOptions *guarded_options = nullptr;
+
+/* Runs `read()` `reads` times on each of `num_threads` threads, and prints the time per
+read (from the start of the first thread to the end of the last) */
+template <typename Read>
+void measure(const char *name, int num_threads, long reads, Read read) {
+    std::vector<std::thread> threads;
+    std::atomic<long> checksum = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int t = 0; t < num_threads; ++t) {
+        threads.emplace_back([&] {
+            long counter = 0;
+            for (long i = 0; i < reads; ++i) {
+                counter += read();
+            }
+            checksum += counter;
+        });
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    auto nanoseconds = std::chrono::duration<double, std::nano>(elapsed).count();
+    std::printf(
+        "%-8s %d threads: %.2f ns/read per thread (checksum %ld)\n",
+        name, num_threads, nanoseconds / static_cast<double>(reads), checksum.load()
+    );
+}
+
+}
+
+int main(int argc, char **argv)
+{
+    int num_threads =
+        argc > 1 ? std::atoi(argv[1]) : static_cast<int>(std::thread::hardware_concurrency());
+    long reads = argc > 2 ? std::atol(argv[2]) : 10'000'000;
+
+    CommandLineOptions options(
+        sizeof(representative_argv) / sizeof(representative_argv[0]), representative_argv
+    );
+    guarded_options = &options;
+    publish_options(options);
+
+    measure("mutex", num_threads, reads, [] {
+        std::lock_guard lock(options_mutex);
+        return guarded_options->spp + guarded_options->seed + guarded_options->quiet;
+    });
+    measure("snapshot", num_threads, reads, [] {
+        auto &snapshot = current_options();
+        return snapshot.spp + snapshot.seed + snapshot.quiet;
+    });
+    return 0;
+}
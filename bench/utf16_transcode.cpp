@@ -0,0 +1,122 @@
+#include "utf16.h"
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+/* `utf16_transcode` first checks `transcode_utf16_to_utf8` against a straightforward reference
+conversion on random UTF-16 text (of random lengths, mixing ASCII, two- and three-byte characters,
+surrogate pairs, and unpaired surrogates), exiting with an error on any mismatch. It then reports
+the conversion throughput for text of several scripts.
+
+Usage: utf16_transcode [ITERATIONS] */
+
+namespace {
+
+/* Converts `input` to UTF-8 one code point at a time */
+auto reference_transcode(const std::u16string &input) -> std::string {
+    std::string output;
+    for (std::size_t i = 0; i < input.size(); ++i) {
+        std::uint32_t c = input[i];
+        if (c >= 0xD800 && c <= 0xDBFF && i + 1 < input.size() && input[i + 1] >= 0xDC00 &&
+            input[i + 1] <= 0xDFFF) {
+            c = 0x10000 + ((c - 0xD800) << 10) + (input[++i] - 0xDC00u);
+        } else if (c >= 0xD800 && c <= 0xDFFF) {
+            c = 0xFFFD;
+        }
+        if (c < 0x80) {
+            output += static_cast<char>(c);
+        } else if (c < 0x800) {
+            output += {static_cast<char>(0xC0 | (c >> 6)), static_cast<char>(0x80 | (c & 0x3F))};
+        } else if (c < 0x10000) {
+            output += {static_cast<char>(0xE0 | (c >> 12)),
+                       static_cast<char>(0x80 | ((c >> 6) & 0x3F)),
+                       static_cast<char>(0x80 | (c & 0x3F))};
+        } else {
+            output += {static_cast<char>(0xF0 | (c >> 18)),
+                       static_cast<char>(0x80 | ((c >> 12) & 0x3F)),
+                       static_cast<char>(0x80 | ((c >> 6) & 0x3F)),
+                       static_cast<char>(0x80 | (c & 0x3F))};
+        }
+    }
+    return output;
+}
+
+/* Returns `length` random code units, drawn from the ranges [first, last] of `ranges` */
+auto random_text(
+    std::mt19937 &rng,
+    std::size_t length,
+    const std::vector<std::pair<char16_t, char16_t>> &ranges
+) -> std::u16string {
+    std::u16string text;
+    while (text.size() < length) {
+        auto [first, last] = ranges[rng() % ranges.size()];
+        text += static_cast<char16_t>(first + rng() % (last - first + 1u));
+    }
+    return text;
+}
+
+auto transcode(const std::u16string &input) -> std::string {
+    std::string output(utf8_size_upper_bound(input.size()), '\0');
+    output.resize(transcode_utf16_to_utf8(input, output.data()));
+    return output;
+}
+
+}
+
+int main(int argc, char **argv)
+{
+    long iterations = argc > 1 ? std::atol(argv[1]) : 100'000;
+
+    /* Check correctness. Runs of each range make the vectorized paths likely to be taken. */
+    std::mt19937 rng(1);
+    const std::vector<std::pair<char16_t, char16_t>> all_ranges = {
+        {0x20, 0x7E}, {0x20, 0x7E}, {0x80, 0x7FF}, {0x800, 0xD7FF}, {0xD800, 0xDBFF},
+        {0xDC00, 0xDFFF}, {0xE000, 0xFFFF}, {0x0, 0xFFFF}
+    };
+    for (int test = 0; test < 200'000; ++test) {
+        std::u16string input;
+        for (int run = 0; run < 4; ++run) {
+            input += random_text(rng, rng() % 20, {all_ranges[rng() % all_ranges.size()]});
+        }
+        if (transcode(input) != reference_transcode(input)) {
+            std::printf("Mismatch for UTF-16 input of %zu code units:", input.size());
+            for (auto c : input) {
+                std::printf(" %04x", static_cast<unsigned>(c));
+            }
+            std::printf("\n");
+            return 1;
+        }
+    }
+    std::printf("200000 random inputs converted correctly\n");
+
+    /* Measure throughput for arguments of 64 code units in several scripts */
+    const std::pair<const char *, std::vector<std::pair<char16_t, char16_t>>> scripts[] = {
+        {"ascii", {{0x20, 0x7E}}},
+        {"cyrillic", {{0x410, 0x44F}}},
+        {"cjk", {{0x4E00, 0x9FFF}}},
+        {"mixed", all_ranges},
+    };
+    for (auto &[name, ranges] : scripts) {
+        auto input = random_text(rng, 64, ranges);
+        std::string output(utf8_size_upper_bound(input.size()), '\0');
+        std::size_t checksum = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (long i = 0; i < iterations; ++i) {
+            checksum += transcode_utf16_to_utf8(input, output.data());
+            checksum += static_cast<unsigned char>(output[i % 8]);
+        }
+        auto elapsed = std::chrono::steady_clock::now() - start;
+        auto nanoseconds = std::chrono::duration<double, std::nano>(elapsed).count();
+        std::printf(
+            "%-9s %.2f ns/code unit (%.0f MiB/s of UTF-16, checksum %zu)\n",
+            name, nanoseconds / static_cast<double>(iterations * input.size()),
+            static_cast<double>(iterations * input.size() * 2) / nanoseconds * 1e9 / (1 << 20),
+            checksum
+        );
+    }
+    return 0;
+}
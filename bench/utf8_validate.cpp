@@ -0,0 +1,126 @@
+#include "utf8.h"
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+/* `utf8_validate` first checks `find_invalid_utf8` against a straightforward reference validator
+(which decodes every sequence and checks the resulting code point) on random byte strings built
+from valid sequences, runs of ASCII, and random bytes, exiting with an error on any mismatch. It
+then reports the validation throughput for text of several kinds.
+
+Usage: utf8_validate [ITERATIONS] */
+
+namespace {
+
+/* Returns the offset of the first invalid sequence of `text`, or `std::string::npos` */
+auto reference_find_invalid(const std::string &text) -> std::size_t {
+    for (std::size_t i = 0; i < text.size();) {
+        auto lead = static_cast<unsigned char>(text[i]);
+        std::size_t length = lead < 0x80 ? 1 : lead >> 5 == 0x6 ? 2 : lead >> 4 == 0xE ? 3 :
+                             lead >> 3 == 0x1E ? 4 : 0;
+        if (length == 0 || i + length > text.size()) {
+            return i;
+        }
+        std::uint32_t code_point = length == 1 ? lead : lead & (0x7F >> length);
+        for (std::size_t j = 1; j < length; ++j) {
+            auto continuation = static_cast<unsigned char>(text[i + j]);
+            if (continuation >> 6 != 0x2) {
+                return i;
+            }
+            code_point = (code_point << 6) | (continuation & 0x3F);
+        }
+        const std::uint32_t minimum[] = {0, 0, 0x80, 0x800, 0x10000};
+        if (code_point < minimum[length] || code_point > 0x10FFFF ||
+            (code_point >= 0xD800 && code_point <= 0xDFFF)) {
+            return i;
+        }
+        i += length;
+    }
+    return std::string::npos;
+}
+
+/* Appends the UTF-8 encoding of `code_point` to `text` */
+void append_utf8(std::string &text, std::uint32_t code_point) {
+    if (code_point < 0x80) {
+        text += static_cast<char>(code_point);
+    } else if (code_point < 0x800) {
+        text += {static_cast<char>(0xC0 | (code_point >> 6)),
+                 static_cast<char>(0x80 | (code_point & 0x3F))};
+    } else if (code_point < 0x10000) {
+        text += {static_cast<char>(0xE0 | (code_point >> 12)),
+                 static_cast<char>(0x80 | ((code_point >> 6) & 0x3F)),
+                 static_cast<char>(0x80 | (code_point & 0x3F))};
+    } else {
+        text += {static_cast<char>(0xF0 | (code_point >> 18)),
+                 static_cast<char>(0x80 | ((code_point >> 12) & 0x3F)),
+                 static_cast<char>(0x80 | ((code_point >> 6) & 0x3F)),
+                 static_cast<char>(0x80 | (code_point & 0x3F))};
+    }
+}
+
+}
+
+int main(int argc, char **argv)
+{
+    long iterations = argc > 1 ? std::atol(argv[1]) : 1'000'000;
+
+    /* Check correctness on strings that are mostly valid, with occasional random bytes (which
+    produce truncated sequences, stray continuation bytes, overlong encodings, and so on) */
+    std::mt19937 rng(1);
+    for (int test = 0; test < 500'000; ++test) {
+        std::string text;
+        auto pieces = rng() % 12;
+        for (unsigned piece = 0; piece < pieces; ++piece) {
+            switch (rng() % 6) {
+            case 0: text.append(rng() % 40, 'a'); break;
+            case 1: append_utf8(text, 0x80 + rng() % 0x780); break;
+            case 2: append_utf8(text, 0x800 + rng() % 0xF800); break;
+            case 3: append_utf8(text, 0x10000 + rng() % 0x100000); break;
+            case 4: append_utf8(text, rng() % 0x110000); break;
+            default: text += static_cast<char>(rng() % (test % 4 == 0 ? 256 : 1)); break;
+            }
+        }
+        if (find_invalid_utf8(text) != reference_find_invalid(text)) {
+            std::printf("Mismatch for input of %zu bytes:", text.size());
+            for (auto c : text) {
+                std::printf(" %02x", static_cast<unsigned>(static_cast<unsigned char>(c)));
+            }
+            std::printf("\n");
+            return 1;
+        }
+    }
+    std::printf("500000 random inputs validated correctly\n");
+
+    /* Measure throughput for a short argument, and for arguments of about 64 bytes */
+    std::string short_text = "--imagefile=a.ppm";
+    std::string ascii_text = "--imagefile=/home/user/renders/2024-05-01/frame_00001_final.ppm";
+    std::string latin_text, cjk_text;
+    while (latin_text.size() < 64) {
+        append_utf8(latin_text, rng() % 4 == 0 ? 0xE0 + rng() % 0x20 : 'a' + rng() % 26);
+    }
+    while (cjk_text.size() < 64) {
+        append_utf8(cjk_text, 0x4E00 + rng() % 0x5200);
+    }
+    const std::pair<const char *, const std::string &> texts[] = {
+        {"short", short_text}, {"ascii", ascii_text}, {"latin", latin_text}, {"cjk", cjk_text}
+    };
+    for (auto &[name, text] : texts) {
+        std::size_t checksum = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (long i = 0; i < iterations; ++i) {
+            checksum += find_invalid_utf8(text) + static_cast<std::size_t>(i);
+        }
+        auto elapsed = std::chrono::steady_clock::now() - start;
+        auto nanoseconds = std::chrono::duration<double, std::nano>(elapsed).count();
+        std::printf(
+            "%-6s %.3f ns/byte (%.0f MiB/s, checksum %zu)\n",
+            name, nanoseconds / static_cast<double>(iterations * text.size()),
+            static_cast<double>(iterations * text.size()) / nanoseconds * 1e9 / (1 << 20), checksum
+        );
+    }
+    return 0;
+}
@@ -0,0 +1,79 @@
+#include "argumentparser.h"
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+/* A libFuzzer target that runs the parser in-process on arbitrary command lines. The fuzz input
+is split on NUL bytes into the arguments after the executable (so the input "-n\0005" becomes
+`cpp_argument_parser -n 5`); the seed corpus in fuzz/corpus/ holds the cases from
+scripts/run_tests.sh in this form, named by their test numbers (including the cases of the unit
+test driver's `options` test, which use the test-only options). The parser is compiled with
+`CPP_ARGUMENT_PARSER_THROW_ON_ERROR`, so that errors in the arguments are thrown as a
+`CommandLineOptionsError` instead of exiting the process, and with `CPP_ARGUMENT_PARSER_FUZZING`,
+with which the values of file-content options (`MappedText`) and path-list options (`PathList`)
+are only checked for errors in their syntax, without opening the files or traversing the
+directories they name (so that inputs such as `--scenes=/**` or `--scenetext=@/dev/zero` neither
+touch the file system nor make the fuzzer's results depend on its contents).
+
+If the environment variable `CPP_ARGUMENT_PARSER_FUZZ_BUDGET_NS` is set, every input that takes
+longer than that many nanoseconds to parse (twice in a row, to filter out preemption and other
+noise) aborts the process, which makes libFuzzer save the input as a crash. This catches inputs
+that are slow without hanging, which libFuzzer's own `-timeout` (with a granularity of seconds)
+does not. */
+
+namespace {
+
+/* Returns the latency budget for one parse, or zero if there is none */
+auto latency_budget() -> std::chrono::nanoseconds {
+    static const auto budget = [] {
+        auto value = std::getenv("CPP_ARGUMENT_PARSER_FUZZ_BUDGET_NS");
+        return std::chrono::nanoseconds(value ? std::strtoll(value, nullptr, 10) : 0);
+    }();
+    return budget;
+}
+
+/* Parses `argv` (which has `argc` entries), returning how long that took */
+auto timed_parse(int argc, char **argv) -> std::chrono::nanoseconds {
+    auto start = std::chrono::steady_clock::now();
+    try {
+        CommandLineOptions options(argc, argv);
+    } catch (const CommandLineOptionsError &) {
+        /* Errors in the arguments are expected; we are only looking for crashes and slowness */
+    }
+    return std::chrono::steady_clock::now() - start;
+}
+
+}
+
+extern "C" int LLVMFuzzerTestOneInput(const std::uint8_t *data, std::size_t size) {
+    /* Copy the input into a string (which is always NUL-terminated), and point an argument at
+    the start of every NUL-separated piece of it */
+    std::string input(reinterpret_cast<const char *>(data), size);
+    char program_name[] = "cpp_argument_parser";
+    std::vector<char *> argv = {program_name};
+    if (!input.empty()) {
+        argv.push_back(input.data());
+        for (std::size_t i = 0; i < input.size(); ++i) {
+            if (input[i] == '\0') {
+                argv.push_back(input.data() + i + 1);
+            }
+        }
+    }
+    auto argc = static_cast<int>(argv.size());
+    argv.push_back(nullptr);
+
+    auto budget = latency_budget();
+    if (timed_parse(argc, argv.data()) > budget && budget.count() > 0) {
+        if (auto elapsed = timed_parse(argc, argv.data()); elapsed > budget) {
+            std::fprintf(
+                stderr, "Parsing took %lld ns, exceeding the budget of %lld ns\n",
+                static_cast<long long>(elapsed.count()), static_cast<long long>(budget.count())
+            );
+            std::abort();
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,64 @@
+/* The `argumentparser` module exports the same interface as include/argumentparser.h (and
+include/optionnames.h, include/optionsoverlay.h, include/optionssnapshot.h, include/output.h,
+include/processoptions.h, include/utf16.h, include/utf8.h, and the headers of the option types: include/boundedint.h,
+include/inlinestring.h, include/mappedtext.h, include/pathlist.h, and include/pattern.h).
+Importing it instead of including the header means that the standard library headers the parser
+needs (`<format>`, `<vector>`, `<string>`, ...) are parsed once, when this module is built, rather
+than once in every translation unit that uses the parser. */
+module;
+
+/* The headers are included in the global module fragment, so that their declarations stay
+attached to the global module, and so remain the same entities as the ones compiled into the
+`argumentparser` library from src/ (which includes the headers directly). */
+#include "argumentparser.h"
+#include "boundedint.h"
+#include "inlinestring.h"
+#include "mappedtext.h"
+#include "optionnames.h"
+#include "optionsoverlay.h"
+#include "optionssnapshot.h"
+#include "output.h"
+#include "pathlist.h"
+#include "pattern.h"
+#include "processoptions.h"
+#include "utf16.h"
+#include "utf8.h"
+
+export module argumentparser;
+
+export using ::CommandLineOptions;
+export using ::OptionChanges;
+export using ::ParseStats;
+export using ::PatternLiteral;
+export using ::PatternString;
+export using ::BoundedInt;
+export using ::IntConstraint;
+export using ::in_steps_of;
+export using ::power_of_two;
+export using ::InlineString;
+export using ::MappedText;
+export using ::PathList;
+export using ::write_stdout;
+export using ::write_stderr;
+export using ::flush_output;
+export using ::process_command_line_options;
+export using ::OptionsOverlay;
+export using ::OptionsSnapshot;
+export using ::publish_options;
+export using ::current_options;
+export using ::reclaim_retired_snapshots;
+export using ::utf8_size_upper_bound;
+export using ::transcode_utf16_to_utf8;
+export using ::find_invalid_utf8;
+#ifdef CPP_ARGUMENT_PARSER_COLLECT_ERRORS
+export using ::ParseDiagnostic;
+#endif
+#ifdef CPP_ARGUMENT_PARSER_THROW_ON_ERROR
+export using ::CommandLineOptionsError;
+#endif
+
+/* Declarations in the global module fragment that nothing in the module purview refers to may
+be discarded, which would make `std::formatter<CommandLineOptions>` unreachable from importers
+(and so `std::format("{}", options)` would fail to compile). Referring to the specialization
+here keeps it. */
+using command_line_options_formatter = std::formatter<CommandLineOptions>;
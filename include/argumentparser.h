@@ -1,7 +1,117 @@
+#pragma once
+
 #include <format>
+#include <optional>
+#include <span>
 #include <vector>
 #include <string>
 #include <string_view>
+#include "parsestats.h"
+
+#ifdef CPP_ARGUMENT_PARSER_TESTING
+/* The types of the test-only options (see `CommandLineOptions`) */
+#include <filesystem>
+#include "boundedint.h"
+#include "inlinestring.h"
+#include "mappedtext.h"
+#include "pathlist.h"
+#include "pattern.h"
+#endif
+
+#ifdef CPP_ARGUMENT_PARSER_COLLECT_ERRORS
+/* In builds with `CPP_ARGUMENT_PARSER_COLLECT_ERRORS` defined, every error in the command-line
+arguments is collected, and the errors are reported together after all of the arguments have been
+parsed. A `ParseDiagnostic` describes one of those errors: the index of the argument it is in (the
+index in `argv`, or in the arguments given to `CommandLineOptions::apply`, counting from 1), the
+option name in that argument as the user typed it (without prefix dashes; empty if the argument is
+not an option), and the error message. */
+struct ParseDiagnostic {
+    std::size_t argument_index;
+    std::string option;
+    std::string message;
+};
+#endif
+
+#ifdef CPP_ARGUMENT_PARSER_THROW_ON_ERROR
+#include <memory>
+#include <stdexcept>
+
+/* In builds with `CPP_ARGUMENT_PARSER_THROW_ON_ERROR` defined (such as the fuzz target in fuzz/),
+errors in the command-line arguments are thrown as a `CommandLineOptionsError` holding the error
+message, instead of being printed before exiting the program. */
+class CommandLineOptionsError : public std::runtime_error {
+#ifdef CPP_ARGUMENT_PARSER_COLLECT_ERRORS
+    /* Shared, so that copying the exception never throws */
+    std::shared_ptr<const std::vector<ParseDiagnostic>> parse_diagnostics;
+#endif
+
+public:
+    using std::runtime_error::runtime_error;
+
+#ifdef CPP_ARGUMENT_PARSER_COLLECT_ERRORS
+    /* Constructs an error holding the messages of all of the errors `parse_diagnostics` in
+    `message` */
+    CommandLineOptionsError(
+        const std::string &message,
+        std::vector<ParseDiagnostic> parse_diagnostics
+    ) : std::runtime_error(message),
+        parse_diagnostics(
+            std::make_shared<const std::vector<ParseDiagnostic>>(std::move(parse_diagnostics))
+        ) {}
+
+    /* Returns every error that was collected, in the order of their arguments (empty if the error
+    was not raised while parsing options, e.g. for invalid UTF-8) */
+    auto diagnostics() const -> std::span<const ParseDiagnostic> {
+        if (!parse_diagnostics) {
+            return {};
+        }
+        return *parse_diagnostics;
+    }
+#endif
+};
+#endif
+
+class CommandLineOptions;
+
+/* `option_tag<Member>` has a distinct address for every field `Member` of `CommandLineOptions`,
+which identifies that field in an `OptionChanges`. */
+template <auto Member>
+inline constexpr char option_tag = 0;
+
+/* `OptionChanges` is the set of options (fields of `CommandLineOptions`) whose values were changed
+by `CommandLineOptions::apply`. */
+class OptionChanges {
+
+    /* `CommandLineOptions` adds the options that it changes */
+    friend class CommandLineOptions;
+
+    /* The `option_tag`s of the changed options */
+    std::vector<const void *> changed_options;
+
+public:
+
+    /* Returns whether the option stored in the field `Member` (e.g. `&CommandLineOptions::spp`)
+    was changed */
+    template <auto Member>
+    auto contains() const -> bool {
+        for (auto changed_option : changed_options) {
+            if (changed_option == &option_tag<Member>) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /* Returns the number of changed options */
+    auto size() const -> std::size_t {
+        return changed_options.size();
+    }
+
+    /* Returns whether no option was changed */
+    auto empty() const -> bool {
+        return changed_options.empty();
+    }
+};
 
 /* `CommandLineOptions` stores a set of program options with values determined from command-line
 arguments passed to this program at launch. It handles verifying and parsing option names and
@@ -9,43 +119,147 @@ values, type-checking, and error handling. The values of the program options are
 the corresponding public fields of this class. */
 class CommandLineOptions {
 
-    /* Returns a `std::vector<std::string>` containing the command-line arguments in order,
-    excluding the first argument (which is always the executable itself). The returned arguments
-    are guaranteed to be encoded in UTF-8. */
-    static auto get_command_line_arguments(int argc, char **argv) -> std::vector<std::string>;
+    /* Tracks the allocations made for storage owned by this parser; see `parse_stats()`. */
+    ParseStatsTracker parse_stats_tracker;
+
+    /* The state of a parser that parses some arguments into a separate set of options, which are
+    then applied to another parser (see `parse_partially` and `apply_partial_parse`). It is defined
+    in src/argumentparser.cpp. */
+    struct PartialParse;
+
+    /* If this parser is the parser of a `PartialParse`, that `PartialParse`; otherwise, `nullptr`.
+    */
+    PartialParse *partial_parse = nullptr;
+
+#ifdef CPP_ARGUMENT_PARSER_COLLECT_ERRORS
+    /* Collects the errors raised while parsing, if it is not `nullptr` (see
+    `CPP_ARGUMENT_PARSER_COLLECT_ERRORS`). It is defined in src/argumentparser.cpp. */
+    struct DiagnosticBuffer;
+    DiagnosticBuffer *diagnostics = nullptr;
+
+    /* Stops collecting errors in `buffer`, and reports the errors in it together, if there were
+    any. */
+    void report_diagnostics(DiagnosticBuffer &buffer);
+#endif
+
+    /* Constructs a `CommandLineOptions` with every option set to its default value, without
+    parsing anything (used for the parsers of `PartialParse`s). */
+    CommandLineOptions() = default;
+
+    /* Parses the arguments of `parse` into its options. `end` is the end of all of the arguments.
+    */
+    static void parse_partially(PartialParse &parse, ArgumentVector::iterator end);
+
+    /* Reports the error raised in `parse`, if there was one; otherwise, sets every option that was
+    set in `parse` to its value there, and returns the options whose values changed. */
+    auto apply_partial_parse(PartialParse &parse) -> OptionChanges;
+
+#ifdef CPP_ARGUMENT_PARSER_PARALLEL_PARSE
+    /* Parses `arguments` in chunks on several threads, if there are enough of them for that to be
+    faster; otherwise, parses them with `parse_arguments`. */
+    void parse_in_parallel(ArgumentVector &arguments);
+#endif
+
+    /* Returns an `ArgumentVector` containing the command-line arguments in order, excluding the
+    first argument (which is always the executable itself). The returned arguments are encoded
+    in UTF-8 (which, on platforms other than Windows, is only verified if
+    `CPP_ARGUMENT_PARSER_VALIDATE_UTF8` is defined). They are views of `argv`, or on Windows, of
+    `argument_text`, into which they are converted. */
+    auto get_command_line_arguments(
+        int argc, char **argv, ParserString &argument_text
+    ) -> ArgumentVector;
+
+    /* Formats the arguments `args...` and prints them to `stdout`, then exits the program (or
+    throws them as a `CommandLineOptionsError`, if `CPP_ARGUMENT_PARSER_THROW_ON_ERROR` is defined).
+    */
+    template <typename... Args>
+    [[noreturn]] void print_then_exit(std::format_string<Args...> format_str, Args&&... args);
 
     /* Attempts to assign the value given by `argument` (a `std::string_view`) to the option
-    `option` of type `T`. */
+    `option` of type `T`. `value_after_equals` tells whether `argument` was given after an `=` in
+    the current argument, rather than as the next argument. */
     template <typename T>
     void try_assign(
         T &option,
         std::string_view argument,
         std::string_view option_name,
-        auto &it
+        auto &it,
+        bool value_after_equals
+    );
+
+    /* Sets the value of `option` from the `curr_option_value` command-line argument passed in by
+    the user for the option named `curr_option_name`. */
+    template <typename T>
+    void set_option(
+        T &option,
+        std::string_view curr_option_name,
+        std::string_view curr_option_value,
+        auto &it,
+        bool bool_cluster,
+        bool value_after_equals
+    );
+
+    /* Calls `set_option`, but is never inlined (used in compact dispatch mode). */
+    template <typename T>
+    void set_option_out_of_line(
+        T &option,
+        std::string_view curr_option_name,
+        std::string_view curr_option_value,
+        ArgumentVector::iterator &it,
+        bool bool_cluster,
+        bool value_after_equals
+    );
+
+    /* Sets the option stored in the field `Member` with `set_option_out_of_line` (used in compact
+    dispatch mode). */
+    template <auto Member>
+    void set_member(
+        std::string_view curr_option_name,
+        std::string_view curr_option_value,
+        ArgumentVector::iterator &it,
+        bool bool_cluster,
+        bool value_after_equals
     );
 
     /* Attempts to set the value of `option` from the `curr_option_name` and `curr_option_value`
-    command-line arguments passed in by the user. */
+    command-line arguments passed in by the user, if the key `curr_option_key` of the option name
+    matches the key `actual_option_key` of this option. */
     template <typename T>
     auto try_set_option(
         T &option,
-        std::string_view actual_option_name,
+        std::string_view actual_option_key,
+        std::string_view curr_option_key,
         std::string_view curr_option_name,
         std::string_view curr_option_value,
         auto &it,
-        bool require_bool
+        bool require_bool,
+        bool value_after_equals
     ) -> bool;
 
+    /* Parses the option in the argument `*it`, advancing `it` if the option takes the argument
+    after it as its value. `end` is the end of all arguments. */
+    void parse_argument(ArgumentVector::iterator &it, ArgumentVector::iterator end);
+
+    /* Parses the options in the arguments from `first` up to (but not including) `last`, and
+    returns the iterator one past the last argument consumed, which is `last`, or the argument after
+    it if the last option took `*last` as its value. `end` is the end of all arguments. */
+    auto parse_arguments(
+        ArgumentVector::iterator first,
+        ArgumentVector::iterator last,
+        ArgumentVector::iterator end
+    ) -> ArgumentVector::iterator;
+
     /* Given the option name `option_name` and value `option_value` from the command-line arguments,
     `try_processing `attempts to set the value of the option corresponding to `option_name` to the
     value given by `option_value`. It returns `true` if success occurs, `false` if no option's name
     matched the `option_name` passed in, and does not return at all if an error is raised instead.
-    */
+    `value_after_equals` tells whether `option_value` was given after an `=` (as in `--spp=4`). */
     auto try_processing(
         std::string_view option_name,
         std::string_view option_value,
         auto &it,
-        bool require_bool = false
+        bool require_bool = false,
+        bool value_after_equals = false
     ) -> bool;
 
 public:
@@ -60,9 +274,47 @@ public:
     bool log_util = false;
     bool partial = false;
 
+#ifdef CPP_ARGUMENT_PARSER_TESTING
+    /* Example options of the supported types that the options above do not use. They only exist in
+    the builds of the unit test driver (tests/unit_tests.cpp) and the fuzz target (fuzz/), which
+    define `CPP_ARGUMENT_PARSER_TESTING`, so that those types are tested through the parser without
+    adding options to the program itself. */
+    PatternString<"[1-9][0-9]{0,4}x[1-9][0-9]{0,4}"> tile_size{"32x32"};
+    InlineString<31> job_name{"render"};
+    MappedText scene_text;
+    PathList scene_paths;
+    std::optional<int> frame;
+    BoundedInt<1, 64> max_depth{8};
+    std::filesystem::path output_dir = "renders";
+#endif
+
     /* Constructs a `CommandLineOptions` using the `argc` command-line arguments stored in
     `argv`. `argc` and `argv` correspond to the argument given to the `main` function. */
     CommandLineOptions(int argc, char **argv);
+
+    /* Parses the arguments `delta_arguments` (which are given like the arguments after the
+    executable in `argv`, e.g. `{"--spp", "512"}`) and sets the options they give, keeping the
+    current values of all other options, and returns the set of options whose values changed. If
+    there is an error in `delta_arguments`, it is reported as in the constructor, and no option is
+    changed. */
+    auto apply(std::span<const std::string_view> delta_arguments) -> OptionChanges;
+
+    /* Parses the arguments `arguments` (which are given like the arguments after the executable
+    in `argv`) into a new `CommandLineOptions`, like the constructor does, except that an error in
+    the arguments is never reported: instead, its message is stored in `error`, and `std::nullopt`
+    is returned. This is meant for long-lived processes that parse the arguments of many jobs (such
+    as the fork server in include/forkserver.h), which must not exit on an error in one of them. */
+    static auto try_parse(
+        std::span<const std::string_view> arguments,
+        std::string &error
+    ) -> std::optional<CommandLineOptions>;
+
+    /* Returns the allocation statistics of the storage owned by this parser while it parsed
+    the command-line arguments. These are all zero unless the `CPP_ARGUMENT_PARSER_PARSE_STATS`
+    (or `CPP_ARGUMENT_PARSER_INSTRUMENTATION`) option is enabled. */
+    auto parse_stats() const -> const ParseStats & {
+        return parse_stats_tracker.get();
+    }
 };
 
 /* Specialize `std::formatter` for `CommandLineOptions` */
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <bit>
+#include <format>
+#include "compiletimeerror.h"
+
+/* Integer options whose values must lie in a range `[Min, Max]` that is fixed at compile time,
+and may also be constrained to steps from `Min`, or to powers of two. For example, options declared
+as
+
+    BoundedInt<1, 65536> spp{64};
+    BoundedInt<16, 1024, in_steps_of(16)> bucket_size{64};
+    BoundedInt<1, 4096, power_of_two> queue_size{256};
+
+only accept values from 1 to 65536, values from 16 to 1024 that are multiples of 16, and powers
+of two from 1 to 4096, respectively. The range is checked inside the loop that converts the digits
+of the value: conversion stops at the first digit that makes the value larger than `Max`, so a
+value such as `--spp=1000000000` is rejected before it is even fully read. Values are given
+without a sign (as for `int` options), so `Min` must not be negative. A default value that is not
+allowed is a compile-time error, in which the call to `compile_time_error` points at the problem. */
+
+/* An additional constraint on the values of a `BoundedInt`, besides its range */
+struct IntConstraint {
+    /* Values must be `Min + k * step` for some integer `k` */
+    int step = 1;
+
+    /* Values must be powers of two */
+    bool power_of_two = false;
+};
+
+/* Constrains values to `Min`, `Min + step`, `Min + 2 * step`, ... */
+consteval auto in_steps_of(int step) -> IntConstraint {
+    return IntConstraint{.step = step};
+}
+
+/* Constrains values to powers of two */
+inline constexpr IntConstraint power_of_two{.power_of_two = true};
+
+class CommandLineOptions;
+
+/* An integer option whose value always lies in `[Min, Max]` and satisfies `Constraint`. Its
+default value must be given with braces (e.g. `BoundedInt<0, 100> percent{50};`), which checks it
+at compile time. */
+template <int Min, int Max, IntConstraint Constraint = IntConstraint{}>
+class BoundedInt {
+    static_assert(
+        0 <= Min && Min <= Max, "The bounds of a BoundedInt must satisfy 0 <= Min <= Max"
+    );
+    static_assert(Constraint.step > 0, "The step of a BoundedInt must be positive");
+
+    /* `CommandLineOptions` sets `value` after checking it against the bounds and the constraint */
+    friend class CommandLineOptions;
+
+    int value;
+
+public:
+
+    static constexpr int min = Min;
+    static constexpr int max = Max;
+    static constexpr IntConstraint constraint = Constraint;
+
+    consteval BoundedInt(int default_value) : value(default_value) {
+        if (default_value < Min || default_value > Max) {
+            compile_time_error("the default value is out of range");
+        }
+        if (!satisfies_constraint(default_value)) {
+            compile_time_error("the default value does not satisfy the constraint");
+        }
+    }
+
+    /* Returns whether `value` (which must be in `[Min, Max]`) satisfies `Constraint` */
+    static constexpr auto satisfies_constraint(int value) -> bool {
+        if constexpr (Constraint.step != 1) {
+            if ((value - Min) % Constraint.step != 0) {
+                return false;
+            }
+        }
+        if constexpr (Constraint.power_of_two) {
+            if (!std::has_single_bit(static_cast<unsigned>(value))) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    auto get() const -> int {
+        return value;
+    }
+
+    operator int() const {
+        return value;
+    }
+
+    auto operator==(const BoundedInt &) const -> bool = default;
+};
+
+/* Whether `T` is a `BoundedInt` */
+template <typename T>
+inline constexpr bool is_bounded_int = false;
+
+template <int Min, int Max, IntConstraint Constraint>
+inline constexpr bool is_bounded_int<BoundedInt<Min, Max, Constraint>> = true;
+
+/* Specialize `std::formatter` for `BoundedInt`, which is formatted as its value */
+template <int Min, int Max, IntConstraint Constraint>
+struct std::formatter<BoundedInt<Min, Max, Constraint>> : public std::formatter<int> {
+    auto format(
+        const BoundedInt<Min, Max, Constraint> &item,
+        std::format_context &format_context
+    ) const {
+        return std::formatter<int>::format(item.get(), format_context);
+    }
+};
@@ -0,0 +1,8 @@
+#pragma once
+
+/* Never defined as `constexpr`, so that calling it while a value is checked at compile time (in a
+`consteval` constructor, or while a pattern is compiled) produces a compile-time error that
+includes `message`. The option types use it to reject invalid defaults and patterns. */
+inline void compile_time_error(const char *message) {
+    (void)message;
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <span>
+#include <string_view>
+#include "argumentparser.h"
+
+/* A fork server (enabled with the `CPP_ARGUMENT_PARSER_FORK_SERVER` option in CMakeLists.txt, on
+platforms other than Windows) runs jobs without starting a new process for each of them: a server
+process, which has already started up (and initialized whatever the jobs share), listens on a Unix
+socket. For each job, a client sends the arguments of the job, along with its own `stdout` and
+`stderr`. The server parses the arguments with `CommandLineOptions::try_parse`, and then forks a
+child, which already has the parsed options in memory; the child writes to the client's `stdout`
+and `stderr`, runs the job, and sends its exit status back to the client. So each job costs one
+`fork` rather than starting up a whole process and parsing its arguments.
+
+An error in the arguments of a job is written to the client's `stdout` by the server (as the
+constructor of `CommandLineOptions` would have), and the job fails with exit status 255, without
+forking. If the server cannot fork, or if the job throws an exception, that error is written to
+the client's `stderr`, and the job fails with exit status 255 as well. Jobs run in the working
+directory and environment of the server, not of the client.
+
+The protocol, on a `SOCK_STREAM` connection, is:
+1. The client sends the size of the arguments (a `std::uint32_t`, in native byte order), along
+   with its `stdout` and `stderr` as `SCM_RIGHTS` ancillary data.
+2. The client sends the arguments, each followed by a NUL character (the format of
+   /proc/self/cmdline, without the executable).
+3. The server (or the child that runs the job) sends the exit status of the job, as a
+   `std::int32_t` in native byte order, and closes the connection. If the child ends without
+   sending its exit status (e.g. because it was killed by a signal), the connection is closed
+   without it. */
+
+/* The most bytes of arguments that the server accepts for one job */
+inline constexpr std::size_t fork_server_max_arguments_size = std::size_t(1) << 20;
+
+/* The longest time, in seconds, that the server waits for more of a request from a client, before
+it closes the connection without running the job */
+inline constexpr int fork_server_receive_timeout_seconds = 5;
+
+/* Runs a fork server on the Unix socket at `socket_path` (replacing any file at that path), which
+runs `job` with the options of each job in a forked child, where the return value of `job` is the
+exit status of the job (or 255, if `job` throws). This only returns if the socket cannot be set
+up, in which case it returns the `errno` value of the error. The server ignores `SIGCHLD`, so that
+its children are reaped automatically (the children restore it before running `job`). */
+auto run_fork_server(
+    const char *socket_path,
+    const std::function<int(const CommandLineOptions &)> &job
+) -> int;
+
+/* Runs a job with the arguments `arguments` on the fork server at `socket_path`, with the `stdout`
+and `stderr` of this process, waits for it to finish, and returns its exit status, or -1 if the
+server could not be reached or the job ended without an exit status. */
+auto run_fork_server_job(
+    const char *socket_path,
+    std::span<const std::string_view> arguments
+) -> int;
@@ -0,0 +1,52 @@
+#pragma once
+
+/* A C-callable drop-in for GNU `getopt_long`, for C tools that want to use this parser without
+being rewritten. Every `getopt_long` name is prefixed with `cap_` (for cpp_argument_parser):
+
+    getopt_long  -> cap_getopt_long
+    struct option -> struct cap_option  (same layout, so existing tables can be cast)
+    optind, optarg, opterr, optopt -> cap_optind, cap_optarg, cap_opterr, cap_optopt
+    no_argument, required_argument, optional_argument -> CAP_NO_ARGUMENT, ...
+
+The semantics follow glibc: short option clusters (`-qv`), attached and separate short option
+values (`-n5`, `-n 5`), optional short option values (`c::` in `optstring`, only attached),
+`--name=value` and `--name value`, unambiguous abbreviations of long options, `--` to end
+option processing, permutation of non-option arguments to the end of `argv` (unless `optstring`
+begins with `+` or `POSIXLY_CORRECT` is set; a leading `-` instead returns non-options as the
+argument of option `1`), a leading `:` in `optstring` to return `:` for missing arguments, and
+resetting the parser by setting `cap_optind` to 0. Long option names are looked up in a sorted
+index that is built once per `longopts` table, rather than by a linear scan of the table on
+every long option. Like `getopt_long`, this is not thread-safe. */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Layout-compatible with `struct option` from `<getopt.h>` */
+struct cap_option {
+    const char *name;
+    int has_arg;
+    int *flag;
+    int val;
+};
+
+#define CAP_NO_ARGUMENT 0
+#define CAP_REQUIRED_ARGUMENT 1
+#define CAP_OPTIONAL_ARGUMENT 2
+
+extern char *cap_optarg;
+extern int cap_optind;
+extern int cap_opterr;
+extern int cap_optopt;
+
+int cap_getopt_long(
+    int argc,
+    char *const argv[],
+    const char *optstring,
+    const struct cap_option *longopts,
+    int *longindex
+);
+
+#ifdef __cplusplus
+}
+#endif
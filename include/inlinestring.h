@@ -0,0 +1,109 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <format>
+#include <string_view>
+#include <type_traits>
+#include "compiletimeerror.h"
+
+/* String options of at most `Capacity` bytes, whose text is stored inside the option itself rather
+than on the heap. For example, an option declared as
+
+    InlineString<31> job_name{"render"};
+
+accepts values of up to 31 bytes; longer values are rejected with an error while parsing. Unlike a
+`std::string`, an `InlineString` never allocates, and is trivially copyable, so a struct of options
+built only from such types (and other trivially copyable types, such as `int`, `bool`, and
+`BoundedInt`) can be copied with `std::memcpy`, e.g. into shared memory or a ring buffer. The text
+is always followed by a NUL character, so `c_str()` needs no copy either. A default value that is
+too long is a compile-time error, in which the call to `compile_time_error` points at the
+problem. */
+
+namespace inline_string_detail {
+
+/* The smallest unsigned type that can hold every length up to `Capacity` */
+template <std::size_t Capacity>
+using Length = std::conditional_t<
+    Capacity <= UINT8_MAX, std::uint8_t,
+    std::conditional_t<Capacity <= UINT16_MAX, std::uint16_t, std::uint32_t>
+>;
+
+}
+
+class CommandLineOptions;
+
+/* A string option of at most `Capacity` bytes, stored inline. Its default value must be given with
+braces (e.g. `InlineString<15> name{"default"};`), which checks its length at compile time. */
+template <std::size_t Capacity>
+class InlineString {
+    static_assert(Capacity > 0, "The capacity of an InlineString must be positive");
+    static_assert(Capacity <= UINT32_MAX, "The capacity of an InlineString must fit in 32 bits");
+
+    /* `CommandLineOptions` sets the value with `assign` after checking its length */
+    friend class CommandLineOptions;
+
+    char text[Capacity + 1] = {};
+    inline_string_detail::Length<Capacity> length = 0;
+
+    /* Sets the value to `value`, which must be at most `Capacity` bytes long */
+    constexpr void assign(std::string_view value) {
+        std::copy_n(value.data(), value.size(), text);
+        std::fill(text + value.size(), text + Capacity + 1, '\0');
+        length = static_cast<inline_string_detail::Length<Capacity>>(value.size());
+    }
+
+public:
+
+    /* The largest number of bytes in a value */
+    static constexpr std::size_t capacity = Capacity;
+
+    consteval InlineString(const char *default_value) {
+        auto value = std::string_view(default_value);
+        if (value.size() > Capacity) {
+            compile_time_error("the default value is too long");
+        }
+        assign(value);
+    }
+
+    auto view() const -> std::string_view {
+        return std::string_view(text, length);
+    }
+
+    auto c_str() const -> const char * {
+        return text;
+    }
+
+    auto size() const -> std::size_t {
+        return length;
+    }
+
+    operator std::string_view() const {
+        return view();
+    }
+
+    auto operator==(const InlineString &other) const -> bool {
+        return view() == other.view();
+    }
+};
+
+static_assert(
+    std::is_trivially_copyable_v<InlineString<31>>,
+    "InlineString must stay trivially copyable, so that it can be copied with std::memcpy"
+);
+
+/* Whether `T` is an `InlineString` */
+template <typename T>
+inline constexpr bool is_inline_string = false;
+
+template <std::size_t Capacity>
+inline constexpr bool is_inline_string<InlineString<Capacity>> = true;
+
+/* Specialize `std::formatter` for `InlineString`, which is formatted as its value */
+template <std::size_t Capacity>
+struct std::formatter<InlineString<Capacity>> : public std::formatter<std::string_view> {
+    auto format(const InlineString<Capacity> &item, std::format_context &format_context) const {
+        return std::formatter<std::string_view>::format(item.view(), format_context);
+    }
+};
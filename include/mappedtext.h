@@ -0,0 +1,75 @@
+#pragma once
+
+#include <cstddef>
+#include <format>
+#include <memory>
+#include <string>
+#include <string_view>
+
+/* Text options whose values may be read from files, for large values such as scene snippets or
+JSON documents. For example, an option declared as
+
+    MappedText scene_text;
+
+can be given either as text (`--scenetext="camera 0 0 5"`), or as the contents of a file
+(`--scenetext=@scene.txt`). The file is memory-mapped (read-only) rather than read: parsing only
+maps it, and its pages are read from the file when they are first accessed. The option owns the
+mapping (shared between copies of the option, so copying it never copies the contents), and the
+contents are available as a `std::string_view` from `view()`. A value that starts with `@@` is
+the text after the first `@` (e.g. `@@home` for `@home`).
+
+The contents of a mapped file are not copied, so the file must not be truncated while the option
+refers to it (accessing pages past the new end of the file raises `SIGBUS` on POSIX systems).
+Changes to the file may or may not be visible through the mapping. */
+
+/* A read-only memory mapping of a whole file. It is defined in src/mappedtext.cpp. */
+class FileMapping;
+
+class CommandLineOptions;
+
+/* A text option whose value is either the text given, or the memory-mapped contents of a file. */
+class MappedText {
+
+    /* `CommandLineOptions` sets the value with `assign` */
+    friend class CommandLineOptions;
+
+    /* The mapping of the file the value was read from, if any; otherwise, the value is `text` */
+    std::shared_ptr<const FileMapping> mapping;
+    std::string text;
+
+    /* Sets the value from the argument `argument` (`@path` for the contents of the file at `path`,
+    or otherwise the text itself). If the file cannot be mapped, returns `false`, with the reason
+    in `error`, and leaves the value unchanged. */
+    auto assign(std::string_view argument, std::string &error) -> bool;
+
+public:
+
+    /* Constructs an option whose value is `default_text` */
+    MappedText(std::string_view default_text = {}) : text(default_text) {}
+
+    /* Returns the value */
+    auto view() const -> std::string_view;
+
+    /* Returns whether the value is the contents of a mapped file */
+    auto is_mapped() const -> bool {
+        return mapping != nullptr;
+    }
+
+    operator std::string_view() const {
+        return view();
+    }
+
+    /* Values are equal if they map the same mapping (without comparing their contents, which may
+    be large), or are the same text. */
+    auto operator==(const MappedText &other) const -> bool {
+        return mapping == other.mapping && text == other.text;
+    }
+};
+
+/* Specialize `std::formatter` for `MappedText`, which is formatted as its value */
+template <>
+struct std::formatter<MappedText> : public std::formatter<std::string_view> {
+    auto format(const MappedText &item, std::format_context &format_context) const {
+        return std::formatter<std::string_view>::format(item.view(), format_context);
+    }
+};
@@ -0,0 +1,131 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include "argumentparser.h"
+
+/* An `OptionName<Member>` associates the name `name` with the option stored in the field of
+`CommandLineOptions` given by the pointer-to-member `Member`. */
+template <auto Member>
+struct OptionName {
+    static constexpr auto member = Member;
+    std::string_view name;
+};
+
+/* Every possible option name, together with the option it sets. If a new option or option
+name is added, one line needs to be added here (the list of fields, `with_option_fields`, is
+derived from it); a new option that should be printed must also be added to
+`std::formatter<CommandLineOptions>` in include/argumentparser.h. The names are passed to `visit`
+as one parameter pack, rather than being stored in a `std::tuple`, because the recursive
+implementation of `std::tuple` exceeds the compiler's template instantiation depth limit
+once there are hundreds of options. */
+inline constexpr auto with_option_names = [](auto visit) {
+    return visit(
+        OptionName<&CommandLineOptions::nthreads>{"nthreads"},
+        OptionName<&CommandLineOptions::nthreads>{"n"},
+        OptionName<&CommandLineOptions::spp>{"spp"},
+        OptionName<&CommandLineOptions::seed>{"seed"},
+        OptionName<&CommandLineOptions::seed>{"s"},
+        OptionName<&CommandLineOptions::image_file>{"imagefile"},
+        OptionName<&CommandLineOptions::input_file>{"input"},
+#ifdef CPP_ARGUMENT_PARSER_TESTING
+        OptionName<&CommandLineOptions::tile_size>{"tilesize"},
+        OptionName<&CommandLineOptions::tile_size>{"t"},
+        OptionName<&CommandLineOptions::job_name>{"jobname"},
+        OptionName<&CommandLineOptions::job_name>{"j"},
+        OptionName<&CommandLineOptions::scene_text>{"scenetext"},
+        OptionName<&CommandLineOptions::scene_paths>{"scenes"},
+        OptionName<&CommandLineOptions::frame>{"frame"},
+        OptionName<&CommandLineOptions::max_depth>{"maxdepth"},
+        OptionName<&CommandLineOptions::output_dir>{"outputdir"},
+#endif
+        OptionName<&CommandLineOptions::quiet>{"quiet"},
+        OptionName<&CommandLineOptions::quiet>{"q"},
+        OptionName<&CommandLineOptions::log_util>{"logutil"},
+        OptionName<&CommandLineOptions::log_util>{"l"},
+        OptionName<&CommandLineOptions::partial>{"partial"},
+        OptionName<&CommandLineOptions::partial>{"p"}
+    );
+};
+
+/* An `OptionField<Member>` stands for the option stored in the field of `CommandLineOptions` given
+by the pointer-to-member `Member`, whose type is `type`. */
+template <auto Member>
+struct OptionField {
+    static constexpr auto member = Member;
+    using type = std::remove_cvref_t<decltype(std::declval<CommandLineOptions &>().*Member)>;
+};
+
+namespace option_names_detail {
+
+/* `NameTable<std::index_sequence<Indices...>, Names...>` derives from one
+`IndexedName<Index, Name>` per option name, so that the name at an index can be found with a
+single overload resolution (see `name_at`). */
+template <std::size_t Index, typename Name>
+struct IndexedName {};
+
+template <typename Indices, typename... Names>
+struct NameTable;
+
+template <std::size_t... Indices, typename... Names>
+struct NameTable<std::index_sequence<Indices...>, Names...> : IndexedName<Indices, Names>... {};
+
+/* Deduces the type of the name at `Index` from the base of a `NameTable` that it appears in */
+template <std::size_t Index, typename Name>
+auto name_at(const IndexedName<Index, Name> &) -> Name;
+
+/* The indices of the names whose option is not set by any earlier name, given the
+`option_tag` of the option of every name, in order */
+template <const char *... Tags>
+struct FirstNames {
+    static constexpr std::array<const char *, sizeof...(Tags)> tags{Tags...};
+
+    static constexpr auto is_first(std::size_t index) -> bool {
+        for (std::size_t i = 0; i < index; i++) {
+            if (tags[i] == tags[index]) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    static constexpr auto indices = [] {
+        constexpr auto count = [] {
+            std::size_t count = 0;
+            for (std::size_t i = 0; i < tags.size(); i++) {
+                count += is_first(i);
+            }
+            return count;
+        }();
+        std::array<std::size_t, count> indices{};
+        for (std::size_t i = 0, j = 0; i < tags.size(); i++) {
+            if (is_first(i)) {
+                indices[j++] = i;
+            }
+        }
+        return indices;
+    }();
+};
+
+}
+
+/* Every field of `CommandLineOptions` that holds an option, once each, in the order in which
+`with_option_names` first names them, so that it never has to be kept in sync by hand. As in
+`with_option_names`, the fields are passed to `visit` as one parameter pack, so that this scales
+to hundreds of options. */
+inline constexpr auto with_option_fields = [](auto visit) {
+    return with_option_names([&](auto... names) {
+        using Names = option_names_detail::NameTable<
+            std::make_index_sequence<sizeof...(names)>, decltype(names)...
+        >;
+        using First = option_names_detail::FirstNames<&option_tag<decltype(names)::member>...>;
+        return [&]<std::size_t... Indices>(std::index_sequence<Indices...>) {
+            return visit(OptionField<
+                decltype(option_names_detail::name_at<First::indices[Indices]>(Names{}))::member
+            >{}...);
+        }(std::make_index_sequence<First::indices.size()>{});
+    });
+};
@@ -0,0 +1,203 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include "argumentparser.h"
+#include "optionnames.h"
+
+namespace overlay_detail {
+
+/* `FieldIndexTable<std::index_sequence<Indices...>, Fields...>` derives from one
+`IndexedField<Index, Field>` per field, so that the index of a field can be found with a single
+overload resolution (see `index_of`), rather than by comparing it with every other field. */
+template <std::size_t Index, typename Field>
+struct IndexedField {};
+
+template <typename Indices, typename... Fields>
+struct FieldIndexTable;
+
+template <std::size_t... Indices, typename... Fields>
+struct FieldIndexTable<std::index_sequence<Indices...>, Fields...>
+    : IndexedField<Indices, Fields>... {};
+
+using FieldTable = decltype(with_option_fields([](auto... fields) {
+    return FieldIndexTable<std::make_index_sequence<sizeof...(fields)>, decltype(fields)...>{};
+}));
+
+/* Deduces the index of `Field` from the base of `FieldTable` that it appears in (a field that is
+not in `with_option_fields` fails to compile here). */
+template <typename Field, std::size_t Index>
+consteval auto index_of(const IndexedField<Index, Field> &) -> std::size_t {
+    return Index;
+}
+
+/* The number of fields */
+inline constexpr std::size_t num_fields = with_option_fields([](auto... fields) {
+    return sizeof...(fields);
+});
+
+/* The index of the field `Member` in `with_option_fields` */
+template <auto Member>
+inline constexpr std::size_t field_index = index_of<OptionField<Member>>(FieldTable{});
+
+/* The size and alignment of the type of each field, in the order of `with_option_fields` */
+inline constexpr auto field_sizes = with_option_fields([](auto... fields) {
+    return std::array<std::size_t, sizeof...(fields)>{sizeof(typename decltype(fields)::type)...};
+});
+inline constexpr auto field_alignments = with_option_fields([](auto... fields) {
+    return std::array<std::size_t, sizeof...(fields)>{alignof(typename decltype(fields)::type)...};
+});
+
+/* The alignment of the storage of the overrides, which is enough for any field, and for the
+offsets stored before the values */
+inline constexpr std::size_t storage_alignment = with_option_fields([](auto... fields) {
+    return std::max({alignof(std::uint32_t), alignof(typename decltype(fields)::type)...});
+});
+
+/* The number of 64-bit words in the presence mask */
+inline constexpr std::size_t num_mask_words = (num_fields + 63) / 64;
+
+}
+
+/* `OptionsOverlay` is a set of options that differs from an immutable base `CommandLineOptions`
+in a few fields (such as the options of one job, which override some of the options of the
+process). Only the overridden fields are stored: the overlay holds a pointer to the base, a
+presence mask with one bit per field (in the order of `with_option_fields`), and one slot per
+overridden field, in field order. Each slot is only as large as the type of its field: the storage
+of the slots starts with the offset of each slot, followed by their values. Reading a field checks
+its bit in the mask; if it is set, the value is in the slot whose index is the number of set bits
+before it (found with `std::popcount`), and otherwise, the value is read from the base. So reading
+takes constant time, and an overlay takes `sizeof(OptionsOverlay)` bytes plus, per override, the
+size of its field and a 4-byte offset (and padding for alignment).
+
+The base must not be changed or destroyed while overlays refer to it (e.g. the `options` of an
+`OptionsSnapshot`; see include/optionssnapshot.h). `flatten()` returns a `CommandLineOptions`
+holding the values of every field of the overlay. */
+class OptionsOverlay {
+
+    /* A unit of the storage of the slots, which is only used for its size and alignment */
+    struct alignas(overlay_detail::storage_alignment) Block {
+        std::byte bytes[overlay_detail::storage_alignment];
+    };
+
+    using PresenceMask = std::array<std::uint64_t, overlay_detail::num_mask_words>;
+
+    const CommandLineOptions *base;
+    PresenceMask presence{};
+
+    /* The offset (from the start of `storage`) of each slot, as a `std::uint32_t`, followed by the
+    values of the slots */
+    std::unique_ptr<Block[]> storage;
+
+    /* Returns the address of the value in the slot at `slot` of the storage `slots` */
+    static auto slot_address(Block *slots, std::size_t slot) -> void * {
+        auto bytes = reinterpret_cast<std::byte *>(slots);
+        std::uint32_t offset;
+        std::memcpy(&offset, bytes + slot * sizeof(offset), sizeof(offset));
+        return bytes + offset;
+    }
+
+    /* Allocates storage for the slots of the overridden fields in `mask`, and stores their offsets
+    in it (the values are left for the caller to construct) */
+    static auto allocate_slots(const PresenceMask &mask) -> std::unique_ptr<Block[]>;
+
+    /* Returns whether the field at `field` is overridden */
+    auto is_present(std::size_t field) const -> bool {
+        return (presence[field / 64] >> (field % 64)) & 1;
+    }
+
+    /* Returns the number of overridden fields before the field at `field` (which is the index of
+    its slot, if it is overridden) */
+    auto rank(std::size_t field) const -> std::size_t {
+        std::size_t num_before = 0;
+        for (std::size_t word = 0; word < field / 64; ++word) {
+            num_before += static_cast<std::size_t>(std::popcount(presence[word]));
+        }
+        auto mask_before = (std::uint64_t(1) << (field % 64)) - 1;
+        return num_before +
+            static_cast<std::size_t>(std::popcount(presence[field / 64] & mask_before));
+    }
+
+    /* Returns the address of the value of the overridden field at `field` */
+    auto slot_of(std::size_t field) const -> void * {
+        return slot_address(storage.get(), rank(field));
+    }
+
+    /* Adds a slot for the field at `field` (which must not be overridden yet), moving the values
+    of the other overridden fields to new storage, and returns the address of the new slot, in
+    which the caller must construct the value of the field. */
+    auto insert_slot(std::size_t field) -> void *;
+
+    /* Destroys the values of all overridden fields */
+    void destroy_slots() noexcept;
+
+public:
+
+    /* Constructs an overlay that overrides no fields of `base` */
+    explicit OptionsOverlay(const CommandLineOptions &base) : base(&base) {}
+
+    OptionsOverlay(const OptionsOverlay &other);
+    OptionsOverlay(OptionsOverlay &&other) noexcept;
+    auto operator=(const OptionsOverlay &other) -> OptionsOverlay &;
+    auto operator=(OptionsOverlay &&other) noexcept -> OptionsOverlay &;
+    ~OptionsOverlay();
+
+    /* Returns the value of the field `Member` (e.g. `&CommandLineOptions::spp`) */
+    template <auto Member>
+    auto get() const -> const typename OptionField<Member>::type & {
+        using T = typename OptionField<Member>::type;
+        constexpr auto field = overlay_detail::field_index<Member>;
+        if (is_present(field)) {
+            return *std::launder(static_cast<const T *>(slot_of(field)));
+        }
+        return base->*Member;
+    }
+
+    /* Overrides the value of the field `Member` with `value` */
+    template <auto Member>
+    void set(typename OptionField<Member>::type value) {
+        using T = typename OptionField<Member>::type;
+        static_assert(
+            std::is_nothrow_move_constructible_v<T>,
+            "Overridden fields are moved between slots, which must not throw"
+        );
+        constexpr auto field = overlay_detail::field_index<Member>;
+        if (is_present(field)) {
+            *std::launder(static_cast<T *>(slot_of(field))) = std::move(value);
+        } else {
+            ::new (insert_slot(field)) T(std::move(value));
+        }
+    }
+
+    /* Returns whether the field `Member` is overridden */
+    template <auto Member>
+    auto overrides() const -> bool {
+        return is_present(overlay_detail::field_index<Member>);
+    }
+
+    /* Returns the number of overridden fields */
+    auto num_overrides() const -> std::size_t {
+        std::size_t num_overridden = 0;
+        for (auto word : presence) {
+            num_overridden += static_cast<std::size_t>(std::popcount(word));
+        }
+        return num_overridden;
+    }
+
+    /* Returns the base options */
+    auto base_options() const -> const CommandLineOptions & {
+        return *base;
+    }
+
+    /* Returns a copy of the base options with every overridden field set to its value in the
+    overlay */
+    auto flatten() const -> CommandLineOptions;
+};
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstddef>
+#include "argumentparser.h"
+
+/* The alignment of `OptionsSnapshot`. This is the size of a cache line on most current CPUs (it
+is not `std::hardware_destructive_interference_size`, whose value may differ between compilers and
+compiler flags, which would change the layout of `OptionsSnapshot` between translation units). */
+inline constexpr std::size_t options_snapshot_alignment = 64;
+
+/* `OptionsSnapshot` is an immutable copy of a set of `CommandLineOptions`, for sharing options
+between many threads without any locking. Snapshots are published with `publish_options` and read
+with `current_options`.
+
+The options that are read most often (by render threads, on every sample) are copied to `const`
+fields at the start of the snapshot, so that reading them is a single load from a cache line that
+holds nothing else that is ever written; the whole snapshot is aligned to (and padded to a multiple
+of) `options_snapshot_alignment` bytes, so that it never shares a cache line with other data. All
+options (including the hot ones) are also available in `options`. */
+class alignas(options_snapshot_alignment) OptionsSnapshot {
+public:
+
+    /* The hot options */
+    const int nthreads;
+    const int spp;
+    const int seed;
+    const bool quiet;
+
+    /* All of the options */
+    const CommandLineOptions options;
+
+    explicit OptionsSnapshot(const CommandLineOptions &options)
+        : nthreads(options.nthreads), spp(options.spp), seed(options.seed), quiet(options.quiet),
+          options(options) {}
+
+    OptionsSnapshot(const OptionsSnapshot &) = delete;
+    auto operator=(const OptionsSnapshot &) -> OptionsSnapshot & = delete;
+};
+
+/* Publishes a snapshot of `options`, which every later call to `current_options` (on any thread)
+returns. The snapshot it replaces is not destroyed right away, because other threads may still be
+reading it; it is retired instead, and destroyed by the next call to `reclaim_retired_snapshots`
+(or at exit). */
+void publish_options(const CommandLineOptions &options);
+
+/* Returns the most recently published snapshot, with a single acquire load of an atomic pointer.
+If no snapshot has been published yet, a snapshot of `process_command_line_options()` (see
+include/processoptions.h) is published first. The returned reference stays valid until the
+snapshot has been replaced and `reclaim_retired_snapshots` is called. */
+auto current_options() -> const OptionsSnapshot &;
+
+/* Destroys the snapshots that have been replaced (along with the storage of their options, e.g.
+the text of their string options, their mapped files and their path lists), and returns how many
+there were. Readers take no locks and leave no trace of the snapshots they hold, so this must only
+be called at a point where no thread still holds a reference from `current_options` taken before
+the latest `publish_options`, e.g. between frames, or once the jobs that read the old options have
+finished. A program that publishes options repeatedly should call this after each publication, once
+it is safe; otherwise the replaced snapshots are only destroyed at exit. */
+auto reclaim_retired_snapshots() -> std::size_t;
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <string_view>
+
+/* All output of the parser and of the `cpp_argument_parser` executable goes through these
+functions, which may be called from any thread. By default, they write to `std::cout` and
+`std::cerr`. In iostream-free builds (see the `CPP_ARGUMENT_PARSER_NO_IOSTREAM` option in
+CMakeLists.txt), they instead write to file descriptors 1 and 2 with `write(2)`, so that
+`<iostream>` (and the static initialization of its stream objects) is not linked at all: text for
+`stdout` is appended to a small buffer (guarded by a mutex), and text for `stderr` is written
+straight through, after flushing that buffer, as with `std::cerr`. */
+
+/* Writes `text` to `stdout` */
+void write_stdout(std::string_view text);
+
+/* Writes `text` to `stderr` */
+void write_stderr(std::string_view text);
+
+/* Flushes everything written so far to `stdout` and `stderr`. In iostream-free builds, `stdout` is
+also flushed automatically at exit (including on `std::exit`). */
+void flush_output();
@@ -0,0 +1,128 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/* `ParseStats` describes the heap allocations made for storage owned by the parser while it
+parsed the command-line arguments: the argument vector (and on Windows, the arguments converted to
+UTF-8), the values assigned to string options (`std::string` and `PatternString` options), and
+formatted error messages. The storage that option types allocate themselves is not counted: the
+values of `std::filesystem::path` options (whose capacity is not exposed), the text given inline to
+`MappedText` options (a mapped file is not allocated at all), and the arenas of `PathList` options
+(along with the buffers of the traversal that fills them). These statistics are only collected when
+the `CPP_ARGUMENT_PARSER_PARSE_STATS` option (or `CPP_ARGUMENT_PARSER_INSTRUMENTATION`, whose parse
+profile reads them) is enabled in CMakeLists.txt; otherwise, every field is always zero. */
+struct ParseStats {
+    std::size_t allocations = 0;  /* The number of allocations made */
+    std::size_t bytes = 0;        /* The total number of bytes allocated */
+    std::size_t peak = 0;         /* The largest number of allocated bytes live at any one time */
+};
+
+/* `ParseStatsTracker` accumulates a `ParseStats` from the allocations and deallocations reported
+to it, keeping track of the number of live bytes in order to compute the peak. */
+class ParseStatsTracker {
+    ParseStats stats;
+    std::size_t live_bytes = 0;
+
+public:
+
+    void record_allocation(std::size_t bytes) {
+        ++stats.allocations;
+        stats.bytes += bytes;
+        live_bytes += bytes;
+        if (live_bytes > stats.peak) {
+            stats.peak = live_bytes;
+        }
+    }
+
+    void record_deallocation(std::size_t bytes) {
+        live_bytes -= bytes;
+    }
+
+    /* Adds the statistics `other` of another tracker, whose allocations may have been live at the
+    same time as those of this one (so that its peak is added on top of the current live bytes). */
+    void merge(const ParseStats &other) {
+        stats.allocations += other.allocations;
+        stats.bytes += other.bytes;
+        if (live_bytes + other.peak > stats.peak) {
+            stats.peak = live_bytes + other.peak;
+        }
+    }
+
+    auto get() const -> const ParseStats & {
+        return stats;
+    }
+};
+
+#ifdef CPP_ARGUMENT_PARSER_PARSE_STATS
+
+/* `CountingAllocator<T>` allocates through `std::allocator<T>`, reporting every allocation and
+deallocation to a `ParseStatsTracker`. Because the tracker is part of the allocator's state,
+statistics are collected per parser without replacing the global `operator new`. */
+template <typename T>
+class CountingAllocator {
+
+    template <typename U>
+    friend class CountingAllocator;
+
+    ParseStatsTracker *tracker;
+
+public:
+
+    using value_type = T;
+
+    explicit CountingAllocator(ParseStatsTracker &tracker) noexcept : tracker(&tracker) {}
+
+    template <typename U>
+    CountingAllocator(const CountingAllocator<U> &other) noexcept : tracker(other.tracker) {}
+
+    auto allocate(std::size_t n) -> T * {
+        auto ptr = std::allocator<T>().allocate(n);
+        tracker->record_allocation(n * sizeof(T));
+        return ptr;
+    }
+
+    void deallocate(T *ptr, std::size_t n) noexcept {
+        tracker->record_deallocation(n * sizeof(T));
+        std::allocator<T>().deallocate(ptr, n);
+    }
+
+    template <typename U>
+    auto operator==(const CountingAllocator<U> &other) const noexcept -> bool {
+        return tracker == other.tracker;
+    }
+};
+
+/* The allocator used for all storage owned by the parser */
+template <typename T>
+using ParserAllocator = CountingAllocator<T>;
+
+template <typename T>
+auto make_parser_allocator(ParseStatsTracker &tracker) -> ParserAllocator<T> {
+    return ParserAllocator<T>(tracker);
+}
+
+#else
+
+/* With parse statistics disabled, the parser allocates through `std::allocator` directly, and
+so pays nothing for the (unused) tracker. */
+template <typename T>
+using ParserAllocator = std::allocator<T>;
+
+template <typename T>
+auto make_parser_allocator(ParseStatsTracker &) -> ParserAllocator<T> {
+    return ParserAllocator<T>();
+}
+
+#endif
+
+/* Strings whose storage is owned by the parser */
+using ParserString = std::basic_string<char, std::char_traits<char>, ParserAllocator<char>>;
+
+/* The arguments being parsed, as views of their text. The text is not copied: it is `argv` itself
+(or the arguments given to `apply` or `try_parse`), or on Windows, the arguments converted to
+UTF-8, all in one `ParserString`. */
+using ArgumentVector = std::vector<std::string_view, ParserAllocator<std::string_view>>;
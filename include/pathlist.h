@@ -0,0 +1,96 @@
+#pragma once
+
+#include <cstddef>
+#include <format>
+#include <memory>
+#include <string>
+#include <string_view>
+
+/* Path-list options, whose values are lists of files that are expanded from glob patterns and
+directories while parsing, rather than by the shell (whose expansion of a large directory tree can
+exceed the limit on the size of the command line). For example, an option declared as
+
+    PathList scene_paths;
+
+can be given as `--scenes='scenes:extra/teapot.obj:shapes_*.obj'`. The value is a list of
+entries, separated by `:` (or by `;` on Windows, as in `PATH`), each of which is one of:
+
+    a glob pattern   every file whose path matches the pattern, where `*` matches any characters
+                     except `/`, `?` matches one such character, `[abc]`, `[a-z]`, and `[!abc]`
+                     match one of the characters listed (or not listed), and a component `**`
+                     matches any number of directories (including none); a directory that matches
+                     stands for every file below it
+    a directory      every file below the directory
+    a file           the file itself
+
+As in the shell, names that start with `.` are only matched by pattern components that start with
+`.` (so hidden files and directories are skipped when expanding `*` or a directory), and paths are
+separated by `/`. Symbolic links to files are listed, but symbolic links to directories are not
+followed. An entry that matches no files, or that has a `[` without a matching `]`, is an error,
+as is a directory that cannot be read (directories below the one an entry starts from that cannot
+be opened, e.g. for lack of permission, are skipped).
+
+Directories are traversed in parallel: each directory that may contain matches is listed by one of
+several threads (with `getdents64` on Linux), and its subdirectories are queued for all of them.
+The threads are only started once there is more than one directory to list at a time; until then,
+directories are listed by the parsing thread alone. After that, threads are started while there
+are more directories queued than threads to list them, up to `std::thread::hardware_concurrency()`.
+The paths found are sorted (by their bytes) and deduplicated, and stored one after another in one
+contiguous arena, which is shared between copies of the option. */
+
+/* The sorted paths of a `PathList`, each followed by a NUL character in `text`, where the `i`th
+path starts at `offsets[i]` (and `offsets` has one more element, one past the end of `text`). It is
+defined in src/pathlist.cpp. */
+struct PathArena;
+
+class CommandLineOptions;
+
+/* A list of paths, expanded from glob patterns and directories. */
+class PathList {
+
+    /* `CommandLineOptions` sets the value with `assign` */
+    friend class CommandLineOptions;
+
+    /* The paths, or `nullptr` if there are none */
+    std::shared_ptr<const PathArena> arena;
+
+    /* Sets the value to the paths expanded from the list of entries `argument`. If an entry cannot
+    be expanded, returns `false`, with the entry and the reason in `error`, and leaves the value
+    unchanged. */
+    auto assign(std::string_view argument, std::string &error) -> bool;
+
+public:
+
+    /* Returns the number of paths */
+    auto size() const -> std::size_t;
+
+    auto empty() const -> bool {
+        return size() == 0;
+    }
+
+    /* Returns the `index`th path, in sorted order */
+    auto operator[](std::size_t index) const -> std::string_view;
+
+    /* Returns the `index`th path as a NUL-terminated string */
+    auto c_str(std::size_t index) const -> const char * {
+        return (*this)[index].data();
+    }
+
+    /* Lists are equal if they share the same paths (without comparing the paths, of which there
+    may be many), or are both empty. */
+    auto operator==(const PathList &other) const -> bool {
+        return arena == other.arena;
+    }
+};
+
+/* Specialize `std::formatter` for `PathList`, which is formatted as its paths, in brackets */
+template <>
+struct std::formatter<PathList> : public std::formatter<std::string_view> {
+    auto format(const PathList &item, std::format_context &format_context) const {
+        auto out = std::format_to(format_context.out(), "[");
+        for (std::size_t i = 0; i < item.size(); ++i) {
+            out = std::format_to(out, "{}{}", i == 0 ? "" : ", ", item[i]);
+        }
+        return std::format_to(out, "]");
+    }
+};
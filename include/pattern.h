@@ -0,0 +1,556 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <format>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+#include "compiletimeerror.h"
+
+/* String options whose values must match a pattern (a regular expression) that is compiled into a
+deterministic finite automaton (DFA) at compile time. For example, an option declared as
+
+    PatternString<"[a-z]+-[0-9]+"> job_id{"render-1"};
+
+only accepts values such as `render-1` or `bake-42`, and checking a value costs one table lookup
+per byte, with no regular expression compiled (or even parsed) at runtime. Patterns always match
+the whole value, and operate on bytes (so a character class such as `[é]` is not supported, but a
+literal `é` in a pattern matches its UTF-8 encoding). The supported syntax is:
+
+    x         the character x (any character other than the special characters below)
+    \x        the character x (for any special character x, e.g. `\.` or `\\`)
+    .         any byte
+    [abc]     any of the listed characters, which may include ranges (`[a-z0-9_]`) and escapes
+    [^abc]    any byte other than the listed characters
+    \d \w \s  a digit, a word character ([0-9A-Za-z_]), or whitespace ([ \t\n\r\f\v])
+    \D \W \S  any byte other than the above
+    (p)       grouping
+    p|q       alternation
+    p* p+ p?  zero or more, one or more, and zero or one repetitions of p
+    p{m} p{m,} p{m,n}
+              exactly m, at least m, and between m and n repetitions of p
+
+The pattern is compiled with the Glushkov (position automaton) construction, followed by the
+subset construction; the bytes are grouped into classes that no part of the pattern tells apart,
+so that the transition table has one column per class rather than one per byte. An invalid
+pattern (or a default value that does not match its pattern) is a compile-time error, in which
+the call to `compile_time_error` points at the problem. */
+
+/* A string literal that can be used as a template argument */
+template <std::size_t N>
+struct PatternLiteral {
+    char text[N] = {};
+
+    consteval PatternLiteral(const char (&literal)[N]) {
+        std::copy_n(literal, N, text);
+    }
+
+    constexpr auto view() const -> std::string_view {
+        return std::string_view(text, N - 1);
+    }
+};
+
+namespace pattern_detail {
+
+/* A set of bytes */
+struct ByteSet {
+    std::uint64_t words[4] = {};
+
+    constexpr void add(unsigned char byte) {
+        words[byte / 64] |= std::uint64_t(1) << (byte % 64);
+    }
+
+    constexpr void add_range(unsigned char first, unsigned char last) {
+        for (unsigned byte = first; byte <= last; ++byte) {
+            add(static_cast<unsigned char>(byte));
+        }
+    }
+
+    constexpr void add_all(const ByteSet &other) {
+        for (int i = 0; i < 4; ++i) {
+            words[i] |= other.words[i];
+        }
+    }
+
+    constexpr void invert() {
+        for (auto &word : words) {
+            word = ~word;
+        }
+    }
+
+    constexpr auto contains(unsigned char byte) const -> bool {
+        return (words[byte / 64] >> (byte % 64)) & 1;
+    }
+};
+
+/* The part of the Glushkov automaton described by a sub-pattern: whether it matches the empty
+string, and the positions that can begin and end its matches */
+struct Fragment {
+    bool nullable = true;
+    std::vector<int> first;
+    std::vector<int> last;
+};
+
+/* Builds the Glushkov automaton of a pattern with a recursive-descent parser. Every occurrence of
+a byte set in the pattern (a character, `.`, a class, ...) is a position; position 0 stands for
+the start of the value. `follow[p]` holds the positions that can come right after position `p`. */
+struct GlushkovBuilder {
+    std::string_view pattern;
+    std::size_t pos = 0;
+    std::vector<ByteSet> sets = {ByteSet{}};
+    std::vector<std::vector<int>> follow = {{}};
+
+    constexpr auto at_end() const -> bool {
+        return pos == pattern.size();
+    }
+
+    constexpr auto peek() const -> char {
+        return pattern[pos];
+    }
+
+    /* Adds a position matching the bytes of `set` */
+    constexpr auto position(const ByteSet &set) -> Fragment {
+        sets.push_back(set);
+        follow.emplace_back();
+        int p = static_cast<int>(sets.size() - 1);
+        return Fragment{false, {p}, {p}};
+    }
+
+    constexpr void connect(const std::vector<int> &from, const std::vector<int> &to) {
+        for (int p : from) {
+            append(follow[static_cast<std::size_t>(p)], to);
+        }
+    }
+
+    static constexpr void append(std::vector<int> &to, const std::vector<int> &from) {
+        to.insert(to.end(), from.begin(), from.end());
+    }
+
+    constexpr auto concatenate(Fragment a, Fragment b) -> Fragment {
+        connect(a.last, b.first);
+        Fragment result{a.nullable && b.nullable, a.first, b.last};
+        if (a.nullable) {
+            append(result.first, b.first);
+        }
+        if (b.nullable) {
+            append(result.last, a.last);
+        }
+        return result;
+    }
+
+    static constexpr auto alternate(Fragment a, Fragment b) -> Fragment {
+        append(a.first, b.first);
+        append(a.last, b.last);
+        a.nullable = a.nullable || b.nullable;
+        return a;
+    }
+
+    constexpr auto repeat_one_or_more(Fragment a) -> Fragment {
+        connect(a.last, a.first);
+        return a;
+    }
+
+    /* Parses the escape sequence after a `\` into `set` */
+    constexpr void escape(ByteSet &set) {
+        if (at_end()) {
+            compile_time_error("the pattern ends with an unfinished escape sequence");
+        }
+        ByteSet escaped;
+        bool invert = false;
+        switch (char c = pattern[pos++]) {
+        case 'D': invert = true; [[fallthrough]];
+        case 'd': escaped.add_range('0', '9'); break;
+        case 'W': invert = true; [[fallthrough]];
+        case 'w':
+            escaped.add_range('0', '9');
+            escaped.add_range('A', 'Z');
+            escaped.add_range('a', 'z');
+            escaped.add('_');
+            break;
+        case 'S': invert = true; [[fallthrough]];
+        case 's': escaped.add_range('\t', '\r'); escaped.add(' '); break;
+        default:
+            if ((c >= '0' && c <= '9') || (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z')) {
+                compile_time_error("unsupported escape sequence");
+            }
+            escaped.add(static_cast<unsigned char>(c));
+        }
+        if (invert) {
+            escaped.invert();
+        }
+        set.add_all(escaped);
+    }
+
+    /* Parses a character class, after its `[` */
+    constexpr auto character_class() -> ByteSet {
+        ByteSet set;
+        bool invert = !at_end() && peek() == '^';
+        pos += invert;
+        if (!at_end() && peek() == ']') {
+            compile_time_error("empty character class (use \\] to match a ']')");
+        }
+        while (!at_end() && peek() != ']') {
+            if (peek() == '\\') {
+                ++pos;
+                escape(set);
+                continue;
+            }
+            auto first = static_cast<unsigned char>(pattern[pos++]);
+            if (pos + 1 < pattern.size() && peek() == '-' && pattern[pos + 1] != ']') {
+                auto last = static_cast<unsigned char>(pattern[pos + 1]);
+                if (last == '\\' || last < first) {
+                    compile_time_error("invalid range in a character class");
+                }
+                set.add_range(first, last);
+                pos += 2;
+            } else {
+                set.add(first);
+            }
+        }
+        if (at_end()) {
+            compile_time_error("unterminated character class");
+        }
+        ++pos;  /* Skip the `]` */
+        if (invert) {
+            set.invert();
+        }
+        return set;
+    }
+
+    constexpr auto atom() -> Fragment {
+        ByteSet set;
+        switch (char c = pattern[pos++]) {
+        case '(': {
+            auto fragment = alternation();
+            if (at_end() || peek() != ')') {
+                compile_time_error("unbalanced '('");
+            }
+            ++pos;
+            return fragment;
+        }
+        case '[': return position(character_class());
+        case '.': set.invert(); return position(set);
+        case '\\': escape(set); return position(set);
+        case ')': case '*': case '+': case '?': case '{': case '}': case ']': case '|':
+        case '^': case '$':
+            compile_time_error(
+                "unexpected special character (use a backslash to match it literally)"
+            );
+            return {};
+        default: set.add(static_cast<unsigned char>(c)); return position(set);
+        }
+    }
+
+    /* Parses a decimal number in a `{m,n}` repetition */
+    constexpr auto number() -> std::size_t {
+        if (at_end() || peek() < '0' || peek() > '9') {
+            compile_time_error("expected a number in a {m,n} repetition");
+        }
+        std::size_t value = 0;
+        while (!at_end() && peek() >= '0' && peek() <= '9') {
+            value = 10 * value + static_cast<std::size_t>(pattern[pos++] - '0');
+            if (value > 1000) {
+                compile_time_error("repetition counts above 1000 are not supported");
+            }
+        }
+        return value;
+    }
+
+    /* Parses an atom followed by any number of quantifiers, stopping at `end`. A `{m,n}`
+    repetition needs a separate copy of its sub-pattern (with positions of its own) for each
+    repetition, which we get by parsing the sub-pattern again. */
+    constexpr auto repetition(std::size_t end = std::string_view::npos) -> Fragment {
+        auto start = pos;
+        auto fragment = atom();
+        while (pos < end && !at_end()) {
+            auto quantifier_start = pos;
+            if (peek() == '*') {
+                ++pos;
+                fragment = repeat_one_or_more(fragment);
+                fragment.nullable = true;
+            } else if (peek() == '+') {
+                ++pos;
+                fragment = repeat_one_or_more(fragment);
+            } else if (peek() == '?') {
+                ++pos;
+                fragment.nullable = true;
+            } else if (peek() == '{') {
+                ++pos;
+                auto minimum = number();
+                auto maximum = minimum;
+                bool unbounded = false;
+                if (!at_end() && peek() == ',') {
+                    ++pos;
+                    unbounded = at_end() || peek() == '}';
+                    maximum = unbounded ? minimum : number();
+                }
+                if (at_end() || peek() != '}') {
+                    compile_time_error("unterminated {m,n} repetition");
+                }
+                ++pos;
+                if (maximum < minimum) {
+                    compile_time_error(
+                        "the maximum of a {m,n} repetition is less than its minimum"
+                    );
+                }
+
+                /* Returns the fragment parsed first, then fresh copies of it */
+                auto quantifier_end = pos;
+                bool original_used = false;
+                auto copy = [&]() -> Fragment {
+                    if (!original_used) {
+                        original_used = true;
+                        return fragment;
+                    }
+                    pos = start;
+                    auto fresh = repetition(quantifier_start);
+                    pos = quantifier_end;
+                    return fresh;
+                };
+
+                Fragment result;
+                for (std::size_t i = 0; i < minimum; ++i) {
+                    result = concatenate(result, copy());
+                }
+                if (unbounded) {
+                    auto rest = repeat_one_or_more(copy());
+                    rest.nullable = true;
+                    result = concatenate(result, rest);
+                } else {
+                    for (std::size_t i = minimum; i < maximum; ++i) {
+                        auto optional = copy();
+                        optional.nullable = true;
+                        result = concatenate(result, optional);
+                    }
+                }
+                fragment = result;
+            } else {
+                break;
+            }
+        }
+        return fragment;
+    }
+
+    constexpr auto concatenation() -> Fragment {
+        Fragment result;
+        while (!at_end() && peek() != '|' && peek() != ')') {
+            result = concatenate(result, repetition());
+        }
+        return result;
+    }
+
+    constexpr auto alternation() -> Fragment {
+        auto result = concatenation();
+        while (!at_end() && peek() == '|') {
+            ++pos;
+            result = alternate(result, concatenation());
+        }
+        return result;
+    }
+};
+
+/* A DFA while it is being built (with dynamically-sized storage, so that it can only exist during
+constant evaluation). State 0 is the dead state (which matches nothing), and state 1 is the start
+state. */
+struct DfaBuilder {
+    std::array<std::uint8_t, 256> byte_class = {};
+    std::size_t num_classes = 1;
+    std::vector<std::size_t> transitions;  /* `transitions[state * num_classes + class]` */
+    std::vector<bool> accepting;
+
+    constexpr auto num_states() const -> std::size_t {
+        return accepting.size();
+    }
+};
+
+constexpr auto build_dfa(std::string_view pattern) -> DfaBuilder {
+    GlushkovBuilder glushkov{pattern};
+    auto root = glushkov.alternation();
+    if (!glushkov.at_end()) {
+        compile_time_error("unbalanced ')'");
+    }
+    glushkov.follow[0] = root.first;
+    auto num_positions = glushkov.sets.size();
+    std::vector<bool> accepting_position(num_positions, false);
+    for (int p : root.last) {
+        accepting_position[static_cast<std::size_t>(p)] = true;
+    }
+    accepting_position[0] = root.nullable;
+
+    /* Split the bytes into classes that every position's byte set either contains entirely, or
+    not at all, by refining the partition once per position */
+    DfaBuilder dfa;
+    for (std::size_t p = 1; p < num_positions; ++p) {
+        std::array<int, 512> renumbered;
+        renumbered.fill(-1);
+        std::size_t num_classes = 0;
+        for (unsigned byte = 0; byte < 256; ++byte) {
+            auto key = 2 * dfa.byte_class[byte] +
+                glushkov.sets[p].contains(static_cast<unsigned char>(byte));
+            if (renumbered[key] == -1) {
+                renumbered[key] = static_cast<int>(num_classes++);
+            }
+            dfa.byte_class[byte] = static_cast<std::uint8_t>(renumbered[key]);
+        }
+        dfa.num_classes = num_classes;
+    }
+    std::vector<unsigned char> representative(dfa.num_classes);
+    for (unsigned byte = 256; byte-- > 0;) {
+        representative[dfa.byte_class[byte]] = static_cast<unsigned char>(byte);
+    }
+
+    /* Subset construction: every DFA state is a sorted set of positions */
+    std::vector<std::vector<int>> states = {{}, {0}};
+    for (std::size_t state = 0; state < states.size(); ++state) {
+        bool accepting = false;
+        for (int p : states[state]) {
+            accepting = accepting || accepting_position[static_cast<std::size_t>(p)];
+        }
+        dfa.accepting.push_back(accepting);
+
+        for (std::size_t byte_class = 0; byte_class < dfa.num_classes; ++byte_class) {
+            std::vector<int> next;
+            for (int p : states[state]) {
+                for (int q : glushkov.follow[static_cast<std::size_t>(p)]) {
+                    auto &set = glushkov.sets[static_cast<std::size_t>(q)];
+                    if (set.contains(representative[byte_class])) {
+                        next.push_back(q);
+                    }
+                }
+            }
+            std::sort(next.begin(), next.end());
+            next.erase(std::unique(next.begin(), next.end()), next.end());
+
+            auto existing = std::find(states.begin(), states.end(), next);
+            dfa.transitions.push_back(static_cast<std::size_t>(existing - states.begin()));
+            if (existing == states.end()) {
+                states.push_back(next);
+            }
+        }
+    }
+    return dfa;
+}
+
+/* The shape of the DFA of `pattern` (the numbers of states and of byte classes) */
+struct DfaShape {
+    std::size_t num_states;
+    std::size_t num_classes;
+};
+
+consteval auto dfa_shape(std::string_view pattern) -> DfaShape {
+    auto dfa = build_dfa(pattern);
+    return DfaShape{dfa.num_states(), dfa.num_classes};
+}
+
+/* A DFA in fixed-size tables. States are stored premultiplied by the number of classes (i.e. as
+offsets of their rows in `transitions`), so that each step of `matches` is one addition and one
+load. */
+template <std::size_t NumStates, std::size_t NumClasses>
+struct Dfa {
+    using State = std::conditional_t<NumStates * NumClasses <= 65536, std::uint16_t, std::uint32_t>;
+
+    std::array<std::uint8_t, 256> byte_class = {};
+    std::array<State, NumStates * NumClasses> transitions = {};
+    std::array<bool, NumStates> accepting = {};
+
+    constexpr auto matches(std::string_view text) const -> bool {
+        State state = NumClasses;  /* The start state */
+        for (char c : text) {
+            state = transitions[state + byte_class[static_cast<unsigned char>(c)]];
+        }
+        return accepting[state / NumClasses];
+    }
+};
+
+template <std::size_t NumStates, std::size_t NumClasses>
+consteval auto compile_dfa(std::string_view pattern) -> Dfa<NumStates, NumClasses> {
+    using State = typename Dfa<NumStates, NumClasses>::State;
+    auto built = build_dfa(pattern);
+    Dfa<NumStates, NumClasses> dfa;
+    dfa.byte_class = built.byte_class;
+    for (std::size_t i = 0; i < NumStates * NumClasses; ++i) {
+        dfa.transitions[i] = static_cast<State>(built.transitions[i] * NumClasses);
+    }
+    for (std::size_t state = 0; state < NumStates; ++state) {
+        dfa.accepting[state] = built.accepting[state];
+    }
+    return dfa;
+}
+
+template <PatternLiteral Pattern>
+inline constexpr auto shape_of = dfa_shape(Pattern.view());
+
+}
+
+/* The DFA compiled from `Pattern` */
+template <PatternLiteral Pattern>
+inline constexpr auto compiled_pattern = pattern_detail::compile_dfa<
+    pattern_detail::shape_of<Pattern>.num_states, pattern_detail::shape_of<Pattern>.num_classes
+>(Pattern.view());
+
+/* The default value of a `PatternString<Pattern>`, which is checked against `Pattern` at compile
+time */
+template <PatternLiteral Pattern>
+struct PatternDefault {
+    const char *text;
+
+    consteval PatternDefault(const char *text) : text(text) {
+        if (!compiled_pattern<Pattern>.matches(text)) {
+            compile_time_error("the default value does not match the pattern");
+        }
+    }
+};
+
+class CommandLineOptions;
+
+/* A string option whose value always matches `Pattern`. Its default value must be given with
+braces (e.g. `PatternString<"[0-9]+"> id{"0"};`), which checks it at compile time. */
+template <PatternLiteral Pattern>
+class PatternString {
+
+    /* `CommandLineOptions` sets `value` after checking it with `matches` */
+    friend class CommandLineOptions;
+
+    std::string value;
+
+public:
+
+    /* The pattern, as written */
+    static constexpr std::string_view pattern = Pattern.view();
+
+    PatternString(PatternDefault<Pattern> default_value) : value(default_value.text) {}
+
+    /* Returns whether `text` matches the pattern */
+    static constexpr auto matches(std::string_view text) -> bool {
+        return compiled_pattern<Pattern>.matches(text);
+    }
+
+    auto str() const -> const std::string & {
+        return value;
+    }
+
+    operator std::string_view() const {
+        return value;
+    }
+
+    auto operator==(const PatternString &) const -> bool = default;
+};
+
+/* Whether `T` is a `PatternString` */
+template <typename T>
+inline constexpr bool is_pattern_string = false;
+
+template <PatternLiteral Pattern>
+inline constexpr bool is_pattern_string<PatternString<Pattern>> = true;
+
+/* Specialize `std::formatter` for `PatternString`, which is formatted as its value */
+template <PatternLiteral Pattern>
+struct std::formatter<PatternString<Pattern>> : public std::formatter<std::string> {
+    auto format(const PatternString<Pattern> &item, std::format_context &format_context) const {
+        return std::formatter<std::string>::format(item.str(), format_context);
+    }
+};
@@ -0,0 +1,20 @@
+#pragma once
+
+#include "argumentparser.h"
+
+/* Returns the options of the current process, parsed from its command-line arguments on the first
+call. Unlike constructing `CommandLineOptions(argc, argv)` in `main`, this needs no access to
+`argv`, and works at any time, including during static initialization (e.g. from the constructors
+of global objects in shared libraries, before `main` is entered), and from any thread.
+
+The arguments are obtained from the C runtime where it makes them available (the `argv` that
+glibc passes to `.init_array` functions, `_NSGetArgv()` on macOS, and `GetCommandLineW()` on
+Windows), or otherwise from /proc/self/cmdline. The parsed options are published through a single
+atomic pointer: once they have been published, every call is just an acquire load. If several
+threads make the first call at once, each parses the arguments, and all but the first to publish
+discard their result; no thread ever waits for another. The published options are never destroyed,
+so the returned reference stays valid until the process exits.
+
+As with `CommandLineOptions`, errors in the command-line arguments are printed before exiting the
+process. */
+auto process_command_line_options() -> const CommandLineOptions &;
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <cstddef>
+#include <string_view>
+
+/* Conversion of UTF-16 text to UTF-8. This is used for the command-line arguments on Windows
+(which are only available losslessly in UTF-16), but is portable, so that UTF-16 text from other
+sources can be converted (and the conversion tested) on any platform. */
+
+/* Returns an upper bound on the number of bytes needed to store the UTF-8 encoding of any
+`utf16_size` UTF-16 code units. Every code unit becomes at most three bytes of UTF-8 (a surrogate
+pair, which is two code units, becomes four bytes). */
+constexpr auto utf8_size_upper_bound(std::size_t utf16_size) -> std::size_t {
+    return 3 * utf16_size;
+}
+
+/* Converts the UTF-16 text `input` to UTF-8 in a single pass, writing the result to `output`
+(which must have room for at least `utf8_size_upper_bound(input.size())` bytes), and returns the
+number of bytes written. No NUL terminator is written. Like `WideCharToMultiByte`, unpaired
+surrogates are replaced by U+FFFD. Runs of ASCII, and of characters below U+0800 (e.g. Latin,
+Greek, Cyrillic, Hebrew, Arabic), are converted eight code units at a time with SSE2 or NEON,
+where available, up to the first block of eight that mixes them or contains other characters;
+from there on, `input` is converted one code point at a time. */
+auto transcode_utf16_to_utf8(std::u16string_view input, char *output) -> std::size_t;
@@ -0,0 +1,15 @@
+#pragma once
+
+#include <cstddef>
+#include <string_view>
+
+/* Validation of UTF-8 text. This is used for the command-line arguments on platforms other than
+Windows, where they are assumed (but not guaranteed) to be UTF-8, when the
+`CPP_ARGUMENT_PARSER_VALIDATE_UTF8` option is enabled. */
+
+/* Returns the offset of the first byte of the first invalid UTF-8 sequence in `text`, or
+`std::string_view::npos` if all of `text` is valid UTF-8. Overlong encodings, encoded surrogates,
+code points above U+10FFFF, and truncated sequences are all invalid. Runs of ASCII are checked 32
+bytes at a time with SSE2 or NEON, where available, so that validating mostly-ASCII text costs
+little more than reading it. */
+auto find_invalid_utf8(std::string_view text) -> std::size_t;
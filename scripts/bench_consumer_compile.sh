@@ -0,0 +1,104 @@
+#!/usr/bin/env bash
+
+# Measures how long it takes to rebuild translation units that use the parser, when they
+# `#include "argumentparser.h"` versus when they `import argumentparser;`.
+#
+# Usage: ./../scripts/bench_consumer_compile.sh [NUM_CONSUMERS] [--header-only]
+#
+# This generates a scratch CMake project containing NUM_CONSUMERS (default 50) consumer
+# translation units of each kind, builds everything once, and then times rebuilding each set of
+# consumers after touching all of their sources (as happens when a widely-included header of the
+# consumer changes). The module variant requires CMake 3.28+, Ninja, and a compiler with C++20
+# module support (GCC 14+, Clang 16+, or MSVC 17.4+); pass --header-only to time only the
+# header variant.
+
+set -e
+
+NUM_CONSUMERS=50
+HEADER_ONLY=0
+for argument in "$@"; do
+    if [ "${argument}" == "--header-only" ]; then
+        HEADER_ONLY=1
+    else
+        NUM_CONSUMERS=${argument}
+    fi
+done
+
+REPOSITORY_DIR=$(cd "$(dirname "$0")/.." && pwd)
+WORK_DIR=$(mktemp -d)
+trap 'rm -rf "${WORK_DIR}"' EXIT
+
+# Writes consumer translation unit number $2 to the file $1, using the preamble $3 (either an
+# #include or an import) to get access to the parser. The consumers only use what the module
+# exports, so that the module variant includes no standard library headers of its own (which
+# would be parsed again in every consumer, and so hide the difference being measured).
+write_consumer() {
+    local file=$1
+    local index=$2
+    local preamble=$3
+    cat > "${file}" <<EOF
+${preamble}
+
+int consumer_${index}(int argc, char **argv) {
+    CommandLineOptions options(argc, argv);
+    write_stdout(options.image_file);
+    return options.nthreads + options.spp + options.seed;
+}
+EOF
+}
+
+# Generate the scratch project
+mkdir -p "${WORK_DIR}/header" "${WORK_DIR}/module"
+for ((i = 0; i < NUM_CONSUMERS; i++)); do
+    write_consumer "${WORK_DIR}/header/consumer_${i}.cpp" "${i}" '#include "argumentparser.h"
+#include "output.h"'
+    write_consumer "${WORK_DIR}/module/consumer_${i}.cpp" "${i}" 'import argumentparser;'
+done
+
+if [ ${HEADER_ONLY} -eq 1 ]; then
+    CMAKE_MINIMUM=3.12
+    BUILD_MODULE=OFF
+    GENERATOR_ARGS=()
+else
+    CMAKE_MINIMUM=3.28
+    BUILD_MODULE=ON
+    GENERATOR_ARGS=(-G Ninja)
+fi
+
+cat > "${WORK_DIR}/CMakeLists.txt" <<EOF
+cmake_minimum_required(VERSION ${CMAKE_MINIMUM})
+project(consumer_compile_bench LANGUAGES CXX)
+set(CMAKE_BUILD_TYPE Release)
+add_subdirectory("${REPOSITORY_DIR}" argumentparser)
+
+file(GLOB HEADER_CONSUMERS header/*.cpp)
+add_library(header_consumers STATIC \${HEADER_CONSUMERS})
+target_link_libraries(header_consumers PRIVATE argumentparser)
+
+if(CPP_ARGUMENT_PARSER_BUILD_MODULE)
+    file(GLOB MODULE_CONSUMERS module/*.cpp)
+    add_library(module_consumers STATIC \${MODULE_CONSUMERS})
+    target_link_libraries(module_consumers PRIVATE argumentparser_module)
+endif()
+EOF
+
+cmake -S "${WORK_DIR}" -B "${WORK_DIR}/build" "${GENERATOR_ARGS[@]}" \
+    -DCPP_ARGUMENT_PARSER_BUILD_MODULE=${BUILD_MODULE} > /dev/null
+cmake --build "${WORK_DIR}/build" > /dev/null
+
+# Touches every consumer in directory $1, then prints how long it takes to rebuild target $2
+time_rebuild() {
+    local directory=$1
+    local target=$2
+    touch "${WORK_DIR}/${directory}"/*.cpp
+    local start=$(date +%s.%N)
+    cmake --build "${WORK_DIR}/build" --target "${target}" > /dev/null
+    local end=$(date +%s.%N)
+    awk -v target="${target}" -v n="${NUM_CONSUMERS}" -v start="${start}" -v end="${end}" \
+        'BEGIN { printf "%s: rebuilt %d consumers in %.2f s\n", target, n, end - start }'
+}
+
+time_rebuild header header_consumers
+if [ ${HEADER_ONLY} -eq 0 ]; then
+    time_rebuild module module_consumers
+fi
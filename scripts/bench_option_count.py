@@ -0,0 +1,145 @@
+#!/usr/bin/env python3
+
+"""Measures how the cost of compiling the parser scales with the number of options.
+
+Usage: ./../scripts/bench_option_count.py [--cxx COMPILER] [--counts 10,100,500,1000] [FLAGS...]
+
+For every option count, this copies include/ and src/ into a scratch directory,
+adds that many synthesized options (cycling through `int`, `bool`, and `std::string` options) to
+the fields of `CommandLineOptions`, the `with_option_names` table in src/argumentparser.cpp, the
+`with_option_fields` list in include/optionsoverlay.h, and the
+`std::formatter<CommandLineOptions>` format string, and then compiles src/argumentparser.cpp once
+per dispatch strategy (inlined, and `CPP_ARGUMENT_PARSER_COMPACT_DISPATCH`). For each compile it
+reports the wall time, the peak memory of the compiler, and the size of the object's `.text`
+section. Any extra FLAGS are passed to the compiler.
+"""
+
+import argparse
+import os
+import re
+import shutil
+import subprocess
+import sys
+import tempfile
+import time
+
+REPOSITORY_DIR = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+
+OPTION_TYPES = [("int", "0"), ("bool", "false"), ("std::string", '"default"')]
+
+STRATEGIES = {
+    "inlined": [],
+    "compact": ["-DCPP_ARGUMENT_PARSER_COMPACT_DISPATCH"],
+}
+
+
+def insert_after(text, anchor, insertion, path):
+    """Inserts `insertion` after the first line of `text` matching the regex `anchor`."""
+    match = re.search(anchor, text, re.MULTILINE)
+    if not match:
+        sys.exit(f"error: could not find /{anchor}/ in {path}; has its layout changed?")
+    end_of_line = text.index("\n", match.end()) + 1
+    return text[:end_of_line] + insertion + text[end_of_line:]
+
+
+def synthesize(work_dir, num_options):
+    """Copies the parser into `work_dir` with `num_options` extra options added."""
+    shutil.copytree(os.path.join(REPOSITORY_DIR, "include"), os.path.join(work_dir, "include"))
+    shutil.copytree(os.path.join(REPOSITORY_DIR, "src"), os.path.join(work_dir, "src"))
+
+    names = [f"synthesized_option_{i}" for i in range(num_options)]
+    types = [OPTION_TYPES[i % len(OPTION_TYPES)] for i in range(num_options)]
+
+    header_path = os.path.join(work_dir, "include", "argumentparser.h")
+    with open(header_path) as header_file:
+        header = header_file.read()
+    header = insert_after(
+        header, r"Each field corresponds to one option",
+        "".join(f"    {type_name} {name} = {default};\n" for name, (type_name, default) in zip(names, types)),
+        header_path
+    )
+    header = insert_after(
+        header, r'^\s*"\{\{\\n"$',
+        "".join(f'            "    {name}: {{}},\\n"\n' for name in names),
+        header_path
+    )
+    header = insert_after(
+        header, r'^\s*"\}\}\\n",$',
+        "".join(f"            item.{name},\n" for name in names),
+        header_path
+    )
+    with open(header_path, "w") as header_file:
+        header_file.write(header)
+
+    overlay_header_path = os.path.join(work_dir, "include", "optionsoverlay.h")
+    with open(overlay_header_path) as overlay_header_file:
+        overlay_header = overlay_header_file.read()
+    overlay_header = insert_after(
+        overlay_header, r"constexpr auto with_option_fields = \[\]\(auto visit\) \{\n\s*return visit\($",
+        "".join(f"        OptionField<&CommandLineOptions::{name}>{{}},\n" for name in names),
+        overlay_header_path
+    )
+    with open(overlay_header_path, "w") as overlay_header_file:
+        overlay_header_file.write(overlay_header)
+
+    source_path = os.path.join(work_dir, "src", "argumentparser.cpp")
+    with open(source_path) as source_file:
+        source = source_file.read()
+    source = insert_after(
+        source, r"constexpr auto with_option_names = \[\]\(auto visit\) \{\n\s*return visit\($",
+        "".join(f'            OptionName<&CommandLineOptions::{name}>{{"{name}"}},\n' for name in names),
+        source_path
+    )
+    with open(source_path, "w") as source_file:
+        source_file.write(source)
+
+
+def text_size(object_path):
+    """Returns the size of the `.text` sections of the object file at `object_path`."""
+    output = subprocess.run(["size", "-A", object_path], capture_output=True, text=True).stdout
+    return sum(int(fields[1]) for fields in (line.split() for line in output.splitlines())
+               if len(fields) >= 2 and fields[0].startswith(".text") and fields[1].isdigit())
+
+
+def compile_once(cxx, work_dir, flags):
+    """Compiles the synthesized parser, returning (seconds, peak memory in MiB, .text bytes), or
+    the first error message of the compiler if compilation failed (as happens, for example, when
+    an option count exceeds a template instantiation depth limit)."""
+    object_path = os.path.join(work_dir, "argumentparser.o")
+    command = [cxx, "-std=c++20", "-O2", "-I", os.path.join(work_dir, "include"), *flags,
+               "-c", os.path.join(work_dir, "src", "argumentparser.cpp"), "-o", object_path]
+
+    start = time.monotonic()
+    process = subprocess.Popen(command, stderr=subprocess.PIPE, text=True)
+    errors = process.stderr.read()
+    _, status, usage = os.wait4(process.pid, 0)
+    seconds = time.monotonic() - start
+    if status != 0:
+        return next((line for line in errors.splitlines() if "error" in line), "unknown error")[:200]
+
+    # `ru_maxrss` is in KiB on Linux, and in bytes on macOS
+    peak_mebibytes = usage.ru_maxrss / (1024 * 1024 if sys.platform == "darwin" else 1024)
+    return seconds, peak_mebibytes, text_size(object_path)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--cxx", default=os.environ.get("CXX", "c++"))
+    parser.add_argument("--counts", default="10,100,500,1000")
+    arguments, extra_flags = parser.parse_known_args()
+
+    print(f"{'options':>8} {'strategy':>9} {'compile_s':>10} {'peak_mib':>9} {'text_bytes':>11}")
+    for num_options in (int(count) for count in arguments.counts.split(",")):
+        with tempfile.TemporaryDirectory() as work_dir:
+            synthesize(work_dir, num_options)
+            for strategy, flags in STRATEGIES.items():
+                result = compile_once(arguments.cxx, work_dir, [*flags, *extra_flags])
+                if isinstance(result, str):
+                    print(f"{num_options:>8} {strategy:>9} failed: {result}", flush=True)
+                else:
+                    seconds, peak, text = result
+                    print(f"{num_options:>8} {strategy:>9} {seconds:>10.2f} {peak:>9.1f} {text:>11}", flush=True)
+
+
+if __name__ == "__main__":
+    main()
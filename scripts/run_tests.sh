@@ -3,23 +3,27 @@
 # Global variables
 CURRENT_TEST_NUMBER=0
 TESTS_PASSED=0
+TESTS_RUN=0
+BUILD_DIR=.  # The build directory of the executables being tested
+EXPECTED_OUTPUT_PREFIX=expected_output  # The prefix of the names of the expected output files
 
-run_test() {
+# Runs the test described by $1, whose output is that of the command $2, and compares that output
+# with the expected output of the test
+run_command_test() {
     # Local variables
-    local test_description=$1  # This means "set `test_description` equal to the first argument of `run_test()`"
-    local command_line_arguments=$2  # The second argument ($2) gives the command-line arguments to call `cpp_argument_parser` with
-    local expected_output_file="../tests/expected_output_${CURRENT_TEST_NUMBER}.txt"
-    # The `mktemp` command creates an unique temporary file, which we'll write the output of calling
-    # `cpp_argument_parser` with the current given command-line arguments to`
+    local test_description=$1  # This means "set `test_description` equal to the first argument of `run_command_test()`"
+    local command=$2  # The second argument ($2) gives the command to run, with its arguments
+    local expected_output_file="../tests/${EXPECTED_OUTPUT_PREFIX}_${CURRENT_TEST_NUMBER}.txt"
+    # The `mktemp` command creates an unique temporary file, which we'll write the output of
+    # running `command` to
     local actual_output_file=$(mktemp)
 
     # Start the test
     echo "Running Test ${CURRENT_TEST_NUMBER} (${test_description})..."
-    echo "Using command ./cpp_argument_parser ${command_line_arguments}"
+    echo "Using command ${command}"
     
-    # Pass the command-line argments in `command_line_arguments` to `cpp_argument_parser`, and
-    # write the resulting output to `actual_output_file`
-    ./cpp_argument_parser ${command_line_arguments} > ${actual_output_file}
+    # Run `command`, and write the resulting output to `actual_output_file`
+    ${command} > ${actual_output_file}
 
     # Use `diff` to compare the actual output to the expected output.
     if diff ${actual_output_file} ${expected_output_file}; then
@@ -31,38 +35,193 @@ run_test() {
     echo ""
 
     ((CURRENT_TEST_NUMBER++))
+    ((TESTS_RUN++))
+}
+
+# Runs a test of `cpp_argument_parser`, described by $1, with the command-line arguments $2
+run_test() {
+    run_command_test "$1" "${BUILD_DIR}/cpp_argument_parser $2"
+}
+
+# Runs the test named $2 (described by $1) of the unit test driver, tests/unit_tests.cpp
+run_unit_test() {
+    run_command_test "$1" "${BUILD_DIR}/cpp_argument_parser_unit_tests $2"
+}
+
+# Runs `cpp_argument_parser` with the arguments $@, and prints the parse profile that it writes to
+# `stderr` instead of its output, with every number replaced by N (as times vary between runs)
+print_parse_profile() {
+    "${BUILD_DIR}/cpp_argument_parser" "$@" 2>&1 > /dev/null | sed -E 's/=[0-9]+/=N/g'
+}
+
+# Runs the unit test driver with the arguments $@, printing what it writes to `stderr` along with
+# its output
+print_output_and_errors() {
+    "${BUILD_DIR}/cpp_argument_parser_unit_tests" "$@" 2>&1
 }
 
-# Test general functionality
-run_test "Test with no command-line arguments given (all options should have their default values)" ""
-run_test "Test all --option[=value]" "--nthreads=4 --spp=100 --seed=1 --imagefile=imagefile.txt --input=inputfile.txt --quiet --logutil --partial"
-run_test "Test all --option[ value]" "--nthreads 4 --spp 100 --seed 1 --imagefile imagefile.txt --input inputfile.txt"
-run_test "Test all -shortened_option[=value]" "-n=4 -s=1 -q -l -p"
-run_test "Test boolean option chaining" "-qlp"
-run_test "Mix" "--nthreads 4 -s=1 -qp -l=false --input other_scene.txt"
-
-# Test errors
-run_test "Emits error on unknown option in --[option]=value" "--something=5"
-run_test "Emits error on unknown option in --[option]" "--something"
-run_test "Emits error on unknown option in -[option]" "-x"
-run_test "Emits error on argument given without option" ""Hello!""
-run_test "Emits error on single dash followed by multi-character argument (-[option]=[...])" "-pqs=5"
-run_test "Emits error on single dash followed by string containing non-boolean single-character argument" "-pqs"
-run_test "Emits error on missing argument for non-boolean option" "--nthreads"
-run_test "Does NOT emit error on missing argument for boolean option (instead, defaults to true)" "--quiet"
-run_test "Emits error on invalid argument to int option" "-n="Hello""
-run_test "Emits error on integer overflow to int option" "-n=2147483648"
-run_test "Does NOT emit error on non-overflowing integer argument to int option" "-n=2147483647"
-run_test "Emits error on missing argument for non-boolean option with equals sign present" "--spp="
+# Builds the target $1, which must fail to compile, and prints whether the errors mention $2
+expect_build_error() {
+    if cmake --build "${BUILD_DIR}" --target "$1" 2>&1 | grep -q "$2"; then
+        echo "The build failed with an error mentioning $2"
+    else
+        echo "The build did not fail with an error mentioning $2"
+    fi
+}
+
+# Prints the value of the variable $1 in the CMake cache of the build directory
+cmake_cache_value() {
+    sed -n "s/^$1:[A-Z]*=//p" CMakeCache.txt
+}
+
+# Builds the executables being tested in their own build directory, configurations/$1, with the
+# build options $2, $3, ... (e.g. CPP_ARGUMENT_PARSER_LOOSE_NAMES) enabled, and with the compiler,
+# flags, and build type of this build directory. The tests run after this test those executables,
+# and compare their outputs with the expected outputs named after the configuration $1 (except for
+# the tests in `run_common_tests`, whose outputs must be the same in every configuration).
+use_configuration() {
+    local name=$1
+    shift
+    local options=()
+    for option in "$@"; do
+        options+=("-D${option}=ON")
+    done
+
+    BUILD_DIR="configurations/${name}"
+    echo "Building configuration ${name} ($*)..."
+    echo ""
+    cmake -S .. -B "${BUILD_DIR}" "${options[@]}" \
+        -DCMAKE_CXX_COMPILER="$(cmake_cache_value CMAKE_CXX_COMPILER)" \
+        -DCMAKE_CXX_FLAGS="$(cmake_cache_value CMAKE_CXX_FLAGS)" \
+        -DCMAKE_BUILD_TYPE="$(cmake_cache_value CMAKE_BUILD_TYPE)" > /dev/null
+    cmake --build "${BUILD_DIR}" --target cpp_argument_parser --parallel > /dev/null
+    cmake --build "${BUILD_DIR}" --target cpp_argument_parser_unit_tests --parallel > /dev/null
+
+    EXPECTED_OUTPUT_PREFIX="expected_output_${name}"
+}
+
+# Runs the tests whose outputs must be the same whichever build options are enabled, numbering
+# them from 0, with the expected outputs tests/expected_output_[number].txt
+run_common_tests() {
+    local expected_output_prefix=${EXPECTED_OUTPUT_PREFIX}
+    EXPECTED_OUTPUT_PREFIX=expected_output
+    CURRENT_TEST_NUMBER=0
+
+    # Test general functionality
+    run_test "Test with no command-line arguments given (all options should have their default values)" ""
+    run_test "Test all --option[=value]" "--nthreads=4 --spp=100 --seed=1 --imagefile=imagefile.txt --input=inputfile.txt --quiet --logutil --partial"
+    run_test "Test all --option[ value]" "--nthreads 4 --spp 100 --seed 1 --imagefile imagefile.txt --input inputfile.txt"
+    run_test "Test all -shortened_option[=value]" "-n=4 -s=1 -q -l -p"
+    run_test "Test boolean option chaining" "-qlp"
+    run_test "Mix" "--nthreads 4 -s=1 -qp -l=false --input other_scene.txt"
+
+    # Test errors
+    run_test "Emits error on unknown option in --[option]=value" "--something=5"
+    run_test "Emits error on unknown option in --[option]" "--something"
+    run_test "Emits error on unknown option in -[option]" "-x"
+    run_test "Emits error on argument given without option" ""Hello!""
+    run_test "Emits error on single dash followed by multi-character argument (-[option]=[...])" "-pqs=5"
+    run_test "Emits error on single dash followed by string containing non-boolean single-character argument" "-pqs"
+    run_test "Emits error on missing argument for non-boolean option" "--nthreads"
+    run_test "Does NOT emit error on missing argument for boolean option (instead, defaults to true)" "--quiet"
+    run_test "Emits error on invalid argument to int option" "-n="Hello""
+    run_test "Emits error on integer overflow to int option" "-n=2147483648"
+    run_test "Does NOT emit error on non-overflowing integer argument to int option" "-n=2147483647"
+    run_test "Emits error on missing argument for non-boolean option with equals sign present" "--spp="
+    run_test "Emits error on argument consisting only of dashes" "--"
+    run_test "Emits error on option-like value after equals sign for boolean option" "--quiet=-x"
+
+    # Test the parts of the parser that the command line cannot reach
+    run_unit_test "UTF-16 to UTF-8 transcoding on each of its paths, and against a reference conversion" "utf16"
+    run_unit_test "Parsing an empty argv (argc == 0) leaves every option at its default value" "empty_argv"
+    run_unit_test "Optional option that is not given has no value" "options"
+    run_unit_test "Optional option given its default value is set, and path option keeps UTF-8 text" "options --frame 0 --outputdir=renders/été"
+    run_unit_test "Bounded int option accepts a value in its range" "options --maxdepth=64"
+    run_unit_test "Emits error on value above the range of a bounded int option" "options --maxdepth=1000000000"
+    run_unit_test "Pattern-validated string option accepts a matching value" "options --tilesize=64x16 -t 128x128"
+    run_unit_test "Emits error on value not matching the pattern of a pattern-validated string option" "options -t=64x"
+    run_unit_test "Inline string option accepts a value up to its capacity" "options --jobname=nightly-bake -j 0123456789012345678901234567890"
+    run_unit_test "Emits error on value longer than the capacity of an inline string option" "options -j=01234567890123456789012345678901"
+    run_unit_test "File-content option value is read from the mapped file" "options --scenetext=@../tests/scene_snippet.txt"
+    run_unit_test "Emits error on file-content option value naming a missing file" "options --scenetext @../tests/missing_scene.txt"
+    run_unit_test "Path-list option expands glob patterns (skipping hidden files) and files, sorted" "options --scenes=../tests/scenes/**/*.obj:../tests/scenes/notes.txt"
+    run_unit_test "Path-list option expands a directory to every file below it" "options --scenes ../tests/scenes/sub"
+    run_unit_test "Emits error on path-list pattern that matches no files" "options --scenes=../tests/scenes/*.fbx"
+    run_unit_test "Emits error on path-list pattern with an unterminated character class" "options --scenes=../tests/scenes/[ab.obj"
+    run_unit_test "Path-list pattern whose character class starts with ] is terminated by the next ]" "options --scenes=../tests/scenes/[]ab].obj"
+    run_unit_test "Loose option names fold ASCII case, and drop - and _" "loose_names imageFile image-file image_file IMAGE__FILE -n- -- Été_X"
+    run_command_test "Two option names with the same loose key fail to compile" "expect_build_error cpp_argument_parser_loose_name_collision duplicate_option_key"
+    run_unit_test "Parsing many arguments in chunks on several threads has the same result as parsing them sequentially" "parallel"
+    run_unit_test "Applying arguments reports the options they changed, and an error in them changes nothing; try_parse returns the error" "apply --nthreads=4 --seed=7"
+    run_unit_test "Options overlay stores, replaces, copies, moves and flattens overrides of different sizes" "overlay --spp=16 --imagefile=base.ppm"
+    run_unit_test "cap_getopt_long has the same results, permutation and error messages as glibc getopt_long (glibc only)" "getopt"
+    run_unit_test "Published option snapshots are read by every thread, and stay readable after they are replaced, until they are reclaimed" "snapshot --spp=16 --seed=32 -n 2 --imagefile=first.ppm"
+    run_unit_test "Boolean options given twice through views of the same characters are set twice" "aliased_arguments --spp=8"
+    run_command_test "Output to stdout and stderr is written in order, and not lost when the process ends without flushing" "print_output_and_errors output"
+
+    EXPECTED_OUTPUT_PREFIX=${expected_output_prefix}
+    CURRENT_TEST_NUMBER=0
+}
+
+# Test the default build (this build directory)
+run_common_tests
+EXPECTED_OUTPUT_PREFIX=expected_output_default
+run_unit_test "Allocation statistics are all zero without parse statistics enabled" "parse_stats --imagefile=renders/frame-0001-of-a-long-animation-name.ppm -n 4"
+
+# Test each build option that changes how arguments are parsed, in a build of its own, running the
+# common tests (whose outputs must not change) and then the tests of that option
+use_configuration instrumentation CPP_ARGUMENT_PARSER_INSTRUMENTATION
+run_common_tests
+run_command_test "Reports the parse profile on stderr as one line of key=value pairs with --logutil" "print_parse_profile --logutil -n 4"
+run_command_test "Does NOT report the parse profile without --logutil" "print_parse_profile -n 4"
+
+use_configuration parse_stats CPP_ARGUMENT_PARSER_PARSE_STATS
+run_common_tests
+run_unit_test "Allocation statistics count the argument vector and the value of a string option" "parse_stats --imagefile=renders/frame-0001-of-a-long-animation-name.ppm -n 4"
+run_unit_test "Allocation statistics do not count a string option value that fits in the string itself" "parse_stats --imagefile=short.ppm -n 4"
+
+use_configuration no_iostream CPP_ARGUMENT_PARSER_NO_IOSTREAM
+run_common_tests
+
+use_configuration compact_dispatch CPP_ARGUMENT_PARSER_COMPACT_DISPATCH
+run_common_tests
+
+use_configuration validate_utf8 CPP_ARGUMENT_PARSER_VALIDATE_UTF8
+run_common_tests
+run_test "Emits error on argument that is not valid UTF-8, giving its number and the offset of the invalid byte" $'--input=\xc3\xa9t\xc3\xa9.txt --imagefile=ab\xff.ppm'
+run_test "Emits error on argument that ends in the middle of a UTF-8 sequence" $'--imagefile=ab\xe2\x82'
+
+use_configuration loose_names CPP_ARGUMENT_PARSER_LOOSE_NAMES
+run_common_tests
+run_test "Option names match ignoring ASCII case, - and _" "--NThreads=4 --image-file=a.ppm --Image_File b.ppm --SEED 7 -Q --Log-Util"
+run_test "Emits error on unknown option, naming it as it was given" "--Image-Files=a.ppm"
+
+use_configuration parallel_parse CPP_ARGUMENT_PARSER_PARALLEL_PARSE
+run_common_tests
+
+use_configuration collect_errors CPP_ARGUMENT_PARSER_COLLECT_ERRORS
+run_common_tests
+run_test "Reports every error, in the order of the arguments" "--nthreads=many --unknown -x --spp=5 --seed=abc -pqs"
+run_test "Skips the value after an option with an error, but not an option after it" "--nthreads many --unknown value --seed x --unknown2 --spp=y"
+run_test "Reports the first 64 errors, and counts the others" "$(printf -- '--unknown%d ' {1..70})"
+
+# (The `parallel` unit test in the common tests checks that a parallel parse collects the same
+# errors as a sequential one)
+use_configuration collect_errors_parallel_parse CPP_ARGUMENT_PARSER_COLLECT_ERRORS CPP_ARGUMENT_PARSER_PARALLEL_PARSE
+run_common_tests
+
+use_configuration fork_server CPP_ARGUMENT_PARSER_FORK_SERVER
+run_common_tests
+run_unit_test "Jobs run on a fork server, after a client that sends nothing times out; a job that throws fails with 255" "fork_server"
 
 # Report statistics (numbr of tests pasased, whether all tests passed or not)
-# The $((CURRENT_TEST_NUMBER - 0)) in place of ${CURRENT_TEST_NUMBER} is for educational
+# The $((TESTS_RUN - 0)) in place of ${TESTS_RUN} is for educational
 # purposes; in bash, double parentheses are used to perform arithmetic (see above, where
-# we did `((CURRENT_TEST_NUMBER++))`), and the $, in this case, is used to access the resulting
+# we did `((TESTS_RUN++))`), and the $, in this case, is used to access the resulting
 # value of the mathematical computation
-echo "${TESTS_PASSED} / $((CURRENT_TEST_NUMBER - 0)) tests passed"
+echo "${TESTS_PASSED} / $((TESTS_RUN - 0)) tests passed"
 
-if [ ${TESTS_PASSED} -eq $((CURRENT_TEST_NUMBER - 0)) ]; then
+if [ ${TESTS_PASSED} -eq $((TESTS_RUN - 0)) ]; then
     echo "ALL TESTS PASSED"
 else
     echo "SOME TESTS FAILED"
@@ -1,39 +1,309 @@
 #include "argumentparser.h"
-#include <iostream>
+#include "boundedint.h"
+#include "inlinestring.h"
+#include "mappedtext.h"
+#include "nameindex.h"
+#include "optionnames.h"
+#include "optionsoverlay.h"
+#include "output.h"
+#include "parseprofile.h"
+#include "pathlist.h"
+#include "pattern.h"
+#include "utf16.h"
+#include "utf8.h"
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <filesystem>
+#include <optional>
+
+#ifdef CPP_ARGUMENT_PARSER_PARALLEL_PARSE
+#include <thread>
+#endif
 
 #ifdef CPP_ARGUMENT_PARSER_IS_ON_WINDOWS
 #include "windows.h"
+#include <cwchar>
+#endif
+
+/* Prevents the compiler from inlining the function it is applied to */
+#ifdef _MSC_VER
+#define CPP_ARGUMENT_PARSER_NOINLINE __declspec(noinline)
+#else
+#define CPP_ARGUMENT_PARSER_NOINLINE [[gnu::noinline]]
 #endif
 
 using namespace std::literals;
 
-/* Formats the arguments `args...` to `stdout` using `std::format` and `std::cout`, then
-calls `std::exit(-1)`. */
+namespace {
+
+/* `is_optional<T>` is `true` iff `T` is a `std::optional` */
+template <typename T>
+constexpr bool is_optional = false;
+
+template <typename T>
+constexpr bool is_optional<std::optional<T>> = true;
+
+/* `is_boolean_option<T>` is `true` iff an option of type `T` holds a `bool` (as a `bool` or a
+`std::optional<bool>`), so that it can be given without a value, and be part of a cluster of
+single-character boolean options. */
+template <typename T>
+constexpr bool is_boolean_option =
+    std::is_same_v<T, bool> || std::is_same_v<T, std::optional<bool>>;
+
+#if defined(CPP_ARGUMENT_PARSER_PARALLEL_PARSE) || defined(CPP_ARGUMENT_PARSER_COLLECT_ERRORS)
+/* Returns whether the argument `argument`, if it is an option, may take the argument after it as
+its value. This is the case for `--option` and `-o`, but not for `--option=value`, `-o=value`,
+clusters of single-character boolean options such as `-abc`, or arguments that are not options
+at all (see the cases in `parse_argument`). If it returns `false`, then the argument after
+`argument` always starts an option (whether `argument` is itself an option, or the value of the
+option before it), or there is an error before it. */
+auto may_take_value(std::string_view argument) -> bool {
+    auto num_prefix_dashes = std::min(argument.find_first_not_of('-'), argument.size());
+    argument.remove_prefix(num_prefix_dashes);
+    return num_prefix_dashes > 0 && !argument.empty() && argument.find('=') == std::string::npos &&
+        (num_prefix_dashes > 1 || argument.size() == 1);
+}
+#endif
+
+#ifdef CPP_ARGUMENT_PARSER_VALIDATE_UTF8
+/* The message of the error for an argument that is not valid UTF-8, given the index of the
+argument (counting from 1), the first invalid byte, and its offset in the argument */
+constexpr const char *invalid_utf8_message =
+    "Error: Argument {} is not valid UTF-8 (invalid byte 0x{:02x} at offset {})";
+#endif
+
+#ifdef CPP_ARGUMENT_PARSER_COLLECT_ERRORS
+/* Returns the name of the option in the argument `argument` as the user typed it (without its
+prefix dashes, or its value after an equals sign), or an empty string if `argument` is not an
+option. */
+auto option_name_of(std::string_view argument) -> std::string_view {
+    auto num_prefix_dashes = std::min(argument.find_first_not_of('-'), argument.size());
+    if (num_prefix_dashes == 0) {
+        return {};
+    }
+    argument.remove_prefix(num_prefix_dashes);
+    return argument.substr(0, argument.find('='));
+}
+#endif
+
+}
+
+#ifdef CPP_ARGUMENT_PARSER_COLLECT_ERRORS
+namespace {
+
+/* The largest number of errors that are collected in one parse, and the largest total size of
+their messages and option names. Errors beyond these limits are counted, but not stored. */
+constexpr std::size_t max_collected_errors = 64;
+constexpr std::size_t max_collected_error_text_size = 16384;
+
+}
+
+/* `DiagnosticBuffer` collects the errors raised while parsing, when
+`CPP_ARGUMENT_PARSER_COLLECT_ERRORS` is defined: `print_then_exit` throws the message of each error
+as a `Resume`, which `parse_arguments` catches to add the error, with the index of its argument and
+the option name in it, to the buffer, before parsing the next option. The messages and option names
+are stored one after another in `text`, and `entries` holds their offsets. The storage for
+`max_collected_errors` errors is reserved when the first error is added, so adding the other errors
+never allocates (and a parse without errors allocates nothing). */
+struct CommandLineOptions::DiagnosticBuffer {
+    struct Resume {
+        ParserString message;
+    };
+
+    struct Entry {
+        std::size_t argument_index;
+        std::size_t option_offset, option_size;
+        std::size_t message_offset, message_size;
+    };
+
+    /* The index (in `argv`) of the first argument that is parsed */
+    std::size_t first_argument_index;
+    ParserString text;
+    std::vector<Entry, ParserAllocator<Entry>> entries;
+    std::size_t num_dropped = 0;
+
+    DiagnosticBuffer(std::size_t first_argument_index, ParseStatsTracker &tracker) :
+        first_argument_index(first_argument_index),
+        text(make_parser_allocator<char>(tracker)),
+        entries(make_parser_allocator<Entry>(tracker)) {}
+
+    /* Adds the error `message` about the option named `option` in the argument at
+    `argument_index`, or counts it as dropped if the buffer is full. */
+    void add(std::size_t argument_index, std::string_view option, std::string_view message) {
+        if (entries.capacity() == 0) {
+            entries.reserve(max_collected_errors);
+            text.reserve(max_collected_error_text_size);
+        }
+        if (entries.size() == max_collected_errors ||
+            text.size() + option.size() + message.size() > max_collected_error_text_size) {
+            ++num_dropped;
+            return;
+        }
+        entries.push_back({
+            argument_index, text.size(), option.size(), text.size() + option.size(), message.size()
+        });
+        text.append(option);
+        text.append(message);
+    }
+
+    /* Adds every error in `other` (which was collected after the errors in this buffer) */
+    void append(const DiagnosticBuffer &other) {
+        for (const auto &entry : other.entries) {
+            add(entry.argument_index, other.option(entry), other.message(entry));
+        }
+        num_dropped += other.num_dropped;
+    }
+
+    auto option(const Entry &entry) const -> std::string_view {
+        return std::string_view(text).substr(entry.option_offset, entry.option_size);
+    }
+
+    auto message(const Entry &entry) const -> std::string_view {
+        return std::string_view(text).substr(entry.message_offset, entry.message_size);
+    }
+
+    /* Returns whether no error was raised */
+    auto empty() const -> bool {
+        return entries.empty() && num_dropped == 0;
+    }
+
+    /* Appends the messages of the errors to `report`, one per line, followed by the number of
+    errors that were dropped, if any */
+    void append_report(ParserString &report) const {
+        for (const auto &entry : entries) {
+            if (!report.empty()) {
+                report.push_back('\n');
+            }
+            report.append(message(entry));
+        }
+        if (num_dropped > 0) {
+            std::format_to(
+                std::back_inserter(report),
+                "{}Error: {} more errors were not shown",
+                report.empty() ? "" : "\n",
+                num_dropped
+            );
+        }
+    }
+};
+#endif
+
+/* `PartialParse` is the state of a parser that parses the arguments from `first` up to `last`
+into a separate set of options, which are then applied to another parser: each chunk of a parallel
+parse is a `PartialParse`, and so are the arguments given to `apply`. The arguments are parsed into
+`options`, which starts with every option set to its default value, and `set_names` records which
+option names (by their index in `with_option_names`) were set, so that only those options are
+applied. Errors are not reported as they are raised (in a parallel parse, an error in a later chunk
+could then be reported before one in an earlier chunk): instead, the message of the first error is
+stored in `error`, and parsing stops by throwing a `Stop`. (If errors are collected, every error is
+added to `diagnostics` instead.) The errors are reported when the `PartialParse` is applied.
+`first_index` is the index of `*first` among all of the arguments. */
+struct CommandLineOptions::PartialParse {
+    struct Stop {};
+
+    CommandLineOptions options;
+    ArgumentVector::iterator first, last;
+    std::vector<bool, ParserAllocator<bool>> set_names;
+    std::optional<std::string> error;
+#ifdef CPP_ARGUMENT_PARSER_COLLECT_ERRORS
+    DiagnosticBuffer diagnostics;
+#endif
+
+    PartialParse(
+        ArgumentVector::iterator first,
+        ArgumentVector::iterator last,
+        [[maybe_unused]] std::size_t first_index,
+        std::size_t num_names,
+        ParseStatsTracker &tracker
+    ) : first(first), last(last), set_names(num_names, false, make_parser_allocator<bool>(tracker))
+#ifdef CPP_ARGUMENT_PARSER_COLLECT_ERRORS
+        /* The buffer allocates with the tracker of `options`, so that chunks parsed on different
+        threads never share a tracker. */
+        , diagnostics(first_index + 1, options.parse_stats_tracker)
+#endif
+    {}
+};
+
+/* Formats the arguments `args...` using `std::format`, writes the result (followed by a newline)
+to `stdout`, flushes it, then calls `std::exit(-1)`. The message is formatted into a `ParserString`,
+so that its storage is accounted for in `parse_stats()`. If `CPP_ARGUMENT_PARSER_THROW_ON_ERROR` is
+defined, the message is instead thrown as a `CommandLineOptionsError`, without printing anything.
+In the parser of a `PartialParse`, the message is stored in the `PartialParse` instead (see there),
+and if errors are being collected, it is thrown as a `DiagnosticBuffer::Resume` (see there). */
 template <typename... Args>
-[[noreturn]] auto print_then_exit(std::format_string<Args...> format_str, Args&&... args) {
-    std::cout << std::format(format_str, std::forward<Args>(args)...) << std::endl;
+[[noreturn]] void CommandLineOptions::print_then_exit(
+    std::format_string<Args...> format_str,
+    Args&&... args
+) {
+    ParserString message(make_parser_allocator<char>(parse_stats_tracker));
+    std::format_to(std::back_inserter(message), format_str, std::forward<Args>(args)...);
+#ifdef CPP_ARGUMENT_PARSER_COLLECT_ERRORS
+    if (diagnostics) {
+        throw DiagnosticBuffer::Resume{std::move(message)};
+    }
+#endif
+    if (partial_parse) {
+        partial_parse->error.emplace(message.data(), message.size());
+        throw PartialParse::Stop{};
+    }
+#ifdef CPP_ARGUMENT_PARSER_THROW_ON_ERROR
+    throw CommandLineOptionsError(std::string(message.data(), message.size()));
+#endif
+    write_stdout(message);
+    write_stdout("\n");
+    flush_output();
     std::exit(-1);
 }
 
-/* Returns a `std::vector<std::string>` containing the command-line arguments in order,
-excluding the first argument (which is always the executable itself). The returned arguments
-are guaranteed to be encoded in UTF-8. */
+/* Returns an `ArgumentVector` containing the command-line arguments in order, excluding the
+first argument (which is always the executable itself). The returned arguments are encoded in
+UTF-8 (which is verified on platforms other than Windows if `CPP_ARGUMENT_PARSER_VALIDATE_UTF8` is
+defined). They are views of `argv`, or on Windows, of `argument_text`, into which they are
+converted. The vector and `argument_text` allocate through `ParserAllocator`, so that they are
+accounted for in `parse_stats()`. */
 auto CommandLineOptions::get_command_line_arguments(
-    int argc, char **argv
-) -> std::vector<std::string> {
+    int argc, char **argv, ParserString &argument_text
+) -> ArgumentVector {
+    CPP_ARGUMENT_PARSER_PROFILE_PHASE(get_arguments);
 
 #ifndef CPP_ARGUMENT_PARSER_IS_ON_WINDOWS
 
     /* In most versions of Linux and OSX, command-line arguments are by-default encoded in
     UTF-8. This is convenient, because UTF-8-encoded strings can be exactly represented by
     `std::string`, as `std::string` is just an array of bytes. Thus, if the current
-    operating system is not Windows, we will directly read each command-line argument
-    (excluding the first one, which is the executable) into a `std::string`, and return the
-    resulting arguments in a `std::vector<std::string>`. */
+    operating system is not Windows, we will directly view each command-line argument
+    (excluding the first one, which is the executable) as a `std::string_view`, without copying
+    it, and return the resulting arguments in an `ArgumentVector`. */
+    (void)argument_text;
 
-    std::vector<std::string> arguments(argc - 1);
+    /* `argc` is 0 if the process was started with an empty `argv` (which `execve` allows), or if
+    `process_command_line_options` could not read the arguments of the process (e.g. without
+    /proc), in which case there is nothing to parse (not even the executable) */
+    ArgumentVector arguments(make_parser_allocator<std::string_view>(parse_stats_tracker));
+    if (argc < 1) {
+        return arguments;
+    }
+    arguments.reserve(static_cast<std::size_t>(argc - 1));
     for (int i = 1; i < argc; ++i) {  /* Skip the first argument */
-        arguments[i - 1] = argv[i];
+        auto argument = std::string_view(argv[i]);
+
+#ifdef CPP_ARGUMENT_PARSER_VALIDATE_UTF8
+        /* Nothing actually guarantees that the arguments are UTF-8, so if UTF-8 validation is
+        enabled, we check that they are (see include/utf8.h), and raise an error giving the
+        position of the first invalid byte otherwise. The argument itself is not printed, so
+        that the invalid bytes do not end up in the output. */
+        if (auto invalid_offset = find_invalid_utf8(argument);
+            invalid_offset != std::string_view::npos) {
+            print_then_exit(
+                invalid_utf8_message,
+                i, static_cast<unsigned>(static_cast<unsigned char>(argument[invalid_offset])),
+                invalid_offset
+            );
+        }
+#endif
+
+        arguments.push_back(argument);
     }
 
     return arguments;
@@ -56,39 +326,38 @@ auto CommandLineOptions::get_command_line_arguments(
     been set to the desired value. */
     int num_args;
     auto argv_wide = CommandLineToArgvW(GetCommandLineW(), &num_args);
+    if (!argv_wide) {
+        /* The command line could not be split into arguments, so there are none to parse */
+        return ArgumentVector(make_parser_allocator<std::string_view>(parse_stats_tracker));
+    }
 
     /* Now, we will convert every command-line argument in `argv_wide` from UTF-16 to UTF-8
     (excluding the first command-line argument because it is just the executable, as before).
-    In total, we will return `num_args - 1` command-line arguments. */
-    std::vector<std::string> arguments(num_args - 1);
-    for (int i = 1; i < num_args; ++i) {  /* Skip the first argument */
-
-        /* First, we find the number of bytes needed to store the UTF-8-encoded version of
-        the current UTF-16-encoded argument, `argv_wide[i]`. This is done with a call to
-        `WideCharToMultiByte`, which is a Windows-specific API designed to convert strings
-        from wide characters (such as UTF-16) to multi-byte character sets such as UTF-8. Note
-        that this count includes the extra byte needed to store the NUL-terminator at the end
-        of the string. */
-        int utf8_size_needed_with_nul_terminator = WideCharToMultiByte(
-            CP_UTF8, 0, argv_wide[i], -1, nullptr, 0, nullptr, nullptr
-        );
+    In total, we will return `num_args - 1` command-line arguments. Rather than calling
+    `WideCharToMultiByte` twice per argument (once to find the size of its UTF-8 encoding, and
+    once to convert it), we convert all arguments in a single pass with
+    `transcode_utf16_to_utf8` (see include/utf16.h), into `argument_text`, which is sized from an
+    upper bound on the size of their UTF-8 encodings (computed from their total length in UTF-16
+    code units). The arguments are views of their slices of `argument_text`, so that converting
+    them takes two allocations in total (one for `argument_text`, and one for `arguments`), rather
+    than one per argument. `argument_text` is never resized after the conversion, so the views stay
+    valid. On Windows, `wchar_t` is 16 bits, so `argv_wide[i]` is UTF-16 text. */
+    std::size_t total_utf16_size = 0;
+    for (int i = 1; i < num_args; ++i) {
+        total_utf16_size += std::wcslen(argv_wide[i]);
+    }
+    argument_text.resize(utf8_size_upper_bound(total_utf16_size));
 
-        /* Now, we will first allocate exactly `utf8_size_needed_with_nul_terminator - 1` bytes
-        to store the current argument as a UTF-8-encoded `std::string`. The reason we subtract
-        one from the size needed with the NUL-terminator is because `std::string` is not
-        explicitly NUL-terminated, unlike C-strings (note that `std::string` is IMplicitly
-        NUL-terminated, though; `str[str.size()]` is guaranteed to equal '\0' since C++11. This
-        is so that methods such as `c_str()` will return a valid NUL-terminated C-string). */
-        auto &curr_arg = arguments[i - 1];
-        curr_arg.resize(utf8_size_needed_with_nul_terminator - 1);
-
-        /* Finally, another call to `WideCharToMultiByte`, this time passing in the address of
-        `curr_arg` (and the size of the target buffer, which is just `curr_arg.size()`), writes
-        the UTF-8 equivalent of `argv_wide[i]` to `curr_arg`, as desired. */
-        WideCharToMultiByte(
-            CP_UTF8, 0, argv_wide[i], -1, curr_arg.data(), static_cast<int>(curr_arg.size()),
-            nullptr, nullptr
+    ArgumentVector arguments(make_parser_allocator<std::string_view>(parse_stats_tracker));
+    arguments.reserve(static_cast<std::size_t>(num_args - 1));
+    auto utf8_arguments = argument_text.data();
+    for (int i = 1; i < num_args; ++i) {  /* Skip the first argument */
+        auto utf16_argument = std::u16string_view(
+            reinterpret_cast<const char16_t *>(argv_wide[i]), std::wcslen(argv_wide[i])
         );
+        auto utf8_size = transcode_utf16_to_utf8(utf16_argument, utf8_arguments);
+        arguments.emplace_back(utf8_arguments, utf8_size);
+        utf8_arguments += utf8_size;
     }
 
     /* Finally, because `CommandLineToArgvW` allocates memory using the Win32 API local memory
@@ -106,19 +375,98 @@ on `argument`; if that succeeds, then the resulting value is assigned to `option
 option `option_name` is passed in for use in error messages, and the current argument iterator `it`
 is passed in so that we can handle cases where two arguments are consumed to initialize an option,
 rather than one (cases such as `--nthreads 5` vs `--nthreads=5`; the first uses up two command-line
-arguments to initialize the `nthreads` option, while the second uses up just one argument). */
+arguments to initialize the `nthreads` option, while the second uses up just one argument).
+`value_after_equals` is `true` if `argument` was given after an `=` in the current argument (as in
+`--nthreads=5`), rather than as the next argument. */
 template <typename T>
 void CommandLineOptions::try_assign(
     T &option,
     std::string_view argument,
     std::string_view option_name,
-    auto &it
+    auto &it,
+    bool value_after_equals
 ) {
+    CPP_ARGUMENT_PARSER_PROFILE_PHASE(convert);
+
     /* Case on the type of `T` */
     if constexpr (std::is_same_v<T, std::string>) {
-        /* If the option type is `std::string`, we just need to assign it to a `std::string`
-        constructed from the `std::string_view` `argument`. */
-        option = std::string(argument);
+        /* If the option type is `std::string`, we just need to assign `argument` to it. */
+#ifndef CPP_ARGUMENT_PARSER_PARSE_STATS
+        option = argument;
+#else
+        /* String options are public fields of type `std::string`, so they allocate through
+        `std::allocator` rather than `ParserAllocator`. To still account for their storage in
+        `parse_stats()`, we record a reallocation whenever the assignment changes the capacity of
+        a heap-allocated buffer (capacities up to that of an empty string fit in the small-string
+        buffer, and so never allocate). */
+        auto old_capacity = option.capacity();
+        option = argument;
+        if (auto new_capacity = option.capacity(); new_capacity != old_capacity) {
+            const auto small_string_capacity = std::string().capacity();
+            if (old_capacity > small_string_capacity) {
+                parse_stats_tracker.record_deallocation(old_capacity + 1);
+            }
+            if (new_capacity > small_string_capacity) {
+                parse_stats_tracker.record_allocation(new_capacity + 1);
+            }
+        }
+#endif
+    } else if constexpr (is_pattern_string<T>) {
+        /* If the option is a `PatternString`, we check `argument` against its pattern with the
+        DFA compiled from it (see include/pattern.h), and then assign it as a `std::string`. */
+        if (!T::matches(argument)) {
+            print_then_exit(
+                "Error: Argument {} for option {} does not match the pattern {}",
+                argument, option_name, T::pattern
+            );
+        }
+        try_assign(option.value, argument, option_name, it, value_after_equals);
+    } else if constexpr (is_inline_string<T>) {
+        /* If the option is an `InlineString` (see include/inlinestring.h), its text is copied into
+        the option itself, after checking that it fits. */
+        if (argument.size() > T::capacity) {
+            print_then_exit(
+                "Error: Argument {} for option {} is {} bytes long, but at most {} bytes are "
+                "allowed",
+                argument, option_name, argument.size(), T::capacity
+            );
+        }
+        option.assign(argument);
+    } else if constexpr (std::is_same_v<T, MappedText>) {
+        /* If the option is a `MappedText` (see include/mappedtext.h), a value of the form `@path`
+        is the contents of the file at `path`, which is memory-mapped (so it is neither read nor
+        copied here), and any other value is the text itself. */
+        if (std::string error; !option.assign(argument, error)) {
+            print_then_exit(
+                "Error: Cannot map the file {} for option {} ({})",
+                argument.substr(1), option_name, error
+            );
+        }
+    } else if constexpr (std::is_same_v<T, PathList>) {
+        /* If the option is a `PathList` (see include/pathlist.h), the glob patterns and directories
+        in `argument` are expanded here, by traversing the directories on several threads. */
+        if (std::string error; !option.assign(argument, error)) {
+            print_then_exit("Error: Cannot expand {} for option {}", error, option_name);
+        }
+    } else if constexpr (std::is_same_v<T, std::filesystem::path>) {
+        /* If the option type is `std::filesystem::path`, the path is constructed once, here, so
+        that code using the option never needs to convert it again. Arguments are encoded in UTF-8,
+        so the path is constructed from a `std::u8string_view` (a path constructed from a
+        `std::string_view` would instead be decoded using the current code page on Windows). The
+        storage of the path is not accounted for in `parse_stats()`, because `std::filesystem::path`
+        does not expose its capacity. */
+        option = std::u8string_view(
+            reinterpret_cast<const char8_t *>(argument.data()), argument.size()
+        );
+    } else if constexpr (is_optional<T>) {
+        /* If the option type is `std::optional<U>`, the option has no value unless one is given
+        on the command line (so that an option that was not given can be told apart from one that
+        was given its default value). We give the option a value, and then assign `argument` to
+        that value as an option of type `U`, so that every supported type `U` can be optional. */
+        if (!option) {
+            option.emplace();
+        }
+        try_assign(*option, argument, option_name, it, value_after_equals);
     } else if constexpr (std::is_same_v<T, char>) {
         /* If the option type is `char`, then all we need to do is verify that `argument`
         has length equal to 1. If it does, we assign the sole character of `argument` to
@@ -144,13 +492,15 @@ void CommandLineOptions::try_assign(
         } else if (argument == "0" || argument == "false") {
             /* We set `option` to `false` if the provided `argument` was "0" or "false". */
             option = false;
-        } else if (argument.front() != '-') {
+        } else if (argument.front() != '-' || value_after_equals) {
             /* If the current boolean option was followed by another command-line argument and
             that argument was none of "1", "true", "0", or "false", then that next command-line
             argument must be the start of another option (because besides "1", "true", "0", or
             "false", we disallow any other values from being provided to a boolean option).
             An argument is an option iff it begins with a dash; if it doesn't, then we have
-            an unexpected argument to the current boolean option. */
+            an unexpected argument to the current boolean option. A value given after an equals
+            sign (e.g. `--quiet=-x`) is always unexpected, because it cannot be the start of
+            another option. */
             print_then_exit(
                 "Error: Unexpected argument {} for boolean option {}",
                 argument, option_name
@@ -170,11 +520,22 @@ void CommandLineOptions::try_assign(
             one more than it should; thus, we decrement it once to negate that effect. */
             --it;
         }
-    } else if constexpr (std::is_same_v<T, int>) {
+    } else if constexpr (std::is_same_v<T, int> || is_bounded_int<T>) {
         /* If the option type is `int`, then we try converting `argument` to an `int`; if that
         succeeds (if `argument` represents a number and that number does not overflow the `int`
-        type), then the resulting value is assigned to `option`. */
-        option = 0;
+        type), then the resulting value is assigned to `option`. A `BoundedInt` (see
+        include/boundedint.h) is converted the same way, except that the largest value allowed is
+        `T::max` rather than the largest `int`: the loop stops at the first digit that makes the
+        value larger than that, so a value far out of range is rejected before it is fully read.
+        Its other requirements are checked once all of the digits have been read. */
+        constexpr int max_value = [] {
+            if constexpr (is_bounded_int<T>) {
+                return T::max;
+            } else {
+                return std::numeric_limits<int>::max();
+            }
+        }();
+        int value = 0;
         for (char c : argument) {
 
             /* If there is a non-digit character in `argument`, then the argument is invalid
@@ -186,15 +547,50 @@ void CommandLineOptions::try_assign(
                 );
             }
 
-            /* Check for integer overflow */
-            if ((std::numeric_limits<T>::max() - (c - '0')) / 10 < option) {
+            /* Check for integer overflow (or, for a `BoundedInt`, for a value above its range) */
+            if ((max_value - (c - '0')) / 10 < value) {
+                if constexpr (is_bounded_int<T>) {
+                    print_then_exit(
+                        "Error: Argument {} for option {} is out of range [{}, {}]",
+                        argument, option_name, T::min, T::max
+                    );
+                } else {
+                    print_then_exit(
+                        "Error: Argument {} overflows for int option {}",
+                        argument, option_name
+                    );
+                }
+            }
+
+            value = 10 * value + (c - '0');
+        }
+
+        if constexpr (is_bounded_int<T>) {
+            if (value < T::min) {
                 print_then_exit(
-                    "Error: Argument {} overflows for int option {}",
-                    argument, option_name
+                    "Error: Argument {} for option {} is out of range [{}, {}]",
+                    argument, option_name, T::min, T::max
                 );
             }
-
-            option = 10 * option + (c - '0');
+            if constexpr (T::constraint.step != 1) {
+                if ((value - T::min) % T::constraint.step != 0) {
+                    print_then_exit(
+                        "Error: Argument {} for option {} is not {} plus a multiple of {}",
+                        argument, option_name, T::min, T::constraint.step
+                    );
+                }
+            }
+            if constexpr (T::constraint.power_of_two) {
+                if (!std::has_single_bit(static_cast<unsigned>(value))) {
+                    print_then_exit(
+                        "Error: Argument {} for option {} is not a power of two",
+                        argument, option_name
+                    );
+                }
+            }
+            option.value = value;
+        } else {
+            option = value;
         }
     } else {
         static_assert(
@@ -204,34 +600,27 @@ void CommandLineOptions::try_assign(
     }
 }
 
-/* Attempts to set the value of `option` from the `curr_option_name` and `curr_option_value`
-command-line arguments passed in by the user. The actual name of the option to test is given
-in `actual_option_name` (which is used to match with `curr_option_name`). Additionally, the
-iterator to the current argument `it` is passed in for use in error messages and for some
-special handling logic within the boolean option case in `try_assign`, and `bool_cluster`
-(whether or not the current option is being set as part of a cluster of single-character
-boolean options in a command-line argument) is used to provide more specific error messages
-to the user. */
+/* Sets the value of `option` from the `curr_option_value` command-line argument passed in by the
+user for the option named `curr_option_name`, after checking that the value is allowed for an
+option of type `T`. The iterator to the current argument `it` is passed in for use in error
+messages and for some special handling logic within the boolean option case in `try_assign`, and
+`bool_cluster` (whether or not the current option is being set as part of a cluster of
+single-character boolean options in a command-line argument) is used to provide more specific
+error messages to the user. `value_after_equals` is forwarded to `try_assign`. */
 template <typename T>
-auto CommandLineOptions::try_set_option(
+void CommandLineOptions::set_option(
     T &option,
-    std::string_view actual_option_name,
     std::string_view curr_option_name,
     std::string_view curr_option_value,
     auto &it,
-    bool bool_cluster
-) -> bool {
-
-    /* If the option name passed in as a command-line argument does not match the actual
-    option name of this `option`, then we obviously cannot set the value of `option` with
-    the given command-line arguments. Thus, we instantly return `false` in this case. */
-    if (actual_option_name != curr_option_name) {
-        return false;
-    }
+    bool bool_cluster,
+    bool value_after_equals
+) {
+    CPP_ARGUMENT_PARSER_PROFILE_PHASE(validate);
 
-    /* If `bool_cluster` is true, then require that the type `T` of the actual `option`
-    be `bool`. */
-    if (bool_cluster && !std::is_same_v<T, bool>) {
+    /* If `bool_cluster` is true, then require that the actual `option` be a boolean option (of
+    type `bool` or `std::optional<bool>`). */
+    if (bool_cluster && !is_boolean_option<T>) {
         print_then_exit(
             "Error: Non-boolean argument {} in {}\nHelp: Single dashes are used "
             "for either one single-character option (e.g. cmd -n 5),\nor for multiple "
@@ -244,19 +633,92 @@ auto CommandLineOptions::try_set_option(
     /* If `option` is not a boolean option, then it must have been given a value. If
     no value was given (i.e. if `curr_option_value` was passed in as the empty string),
     then raise an error. */
-    if (!std::is_same_v<T, bool> && curr_option_value.empty()) {
+    if (!is_boolean_option<T> && curr_option_value.empty()) {
         print_then_exit("Error: Missing value for option {}", curr_option_name);
     }
 
     /* Otherwise, try to set the value of `option` from the sequence of characters given in
     `curr_option_name`. */
-    try_assign(option, curr_option_value, curr_option_name, it);
+    try_assign(option, curr_option_value, curr_option_name, it, value_after_equals);
+}
+
+/* Attempts to set the value of `option` from the `curr_option_name` and `curr_option_value`
+command-line arguments passed in by the user. Option names are matched by their keys: the key of
+the name of this `option` is given in `actual_option_key`, and is compared with the key
+`curr_option_key` of `curr_option_name` (the key of a name is the name itself, unless
+`CPP_ARGUMENT_PARSER_LOOSE_NAMES` is defined; see `fold_option_name`). If the keys match, the
+option is set with `set_option` (to which `it`, `bool_cluster` and `value_after_equals` are
+forwarded). */
+template <typename T>
+auto CommandLineOptions::try_set_option(
+    T &option,
+    std::string_view actual_option_key,
+    std::string_view curr_option_key,
+    std::string_view curr_option_name,
+    std::string_view curr_option_value,
+    auto &it,
+    bool bool_cluster,
+    bool value_after_equals
+) -> bool {
+
+    /* If the key of the option name passed in as a command-line argument does not match the
+    key of this `option`, then we obviously cannot set the value of `option` with the given
+    command-line arguments. Thus, we instantly return `false` in this case. */
+    if (actual_option_key != curr_option_key) {
+        return false;
+    }
+
+    set_option(
+        option, curr_option_name, curr_option_value, it, bool_cluster, value_after_equals
+    );
 
     /* If the above function returns without terminating the program, then assignment succeeded,
     and so we return `true`. Success! */
     return true;
 }
 
+/* Calls `set_option`, but is never inlined. In compact dispatch mode, this is instantiated once
+per option type, and shared by all options of that type. */
+template <typename T>
+CPP_ARGUMENT_PARSER_NOINLINE void CommandLineOptions::set_option_out_of_line(
+    T &option,
+    std::string_view curr_option_name,
+    std::string_view curr_option_value,
+    ArgumentVector::iterator &it,
+    bool bool_cluster,
+    bool value_after_equals
+) {
+    set_option(
+        option, curr_option_name, curr_option_value, it, bool_cluster, value_after_equals
+    );
+}
+
+/* Sets the option `Member` (a pointer to a field of `CommandLineOptions`). In compact dispatch
+mode, this is the function stored in each option's descriptor; it is only a thin thunk that
+calls `set_option_out_of_line` on the field, so that there is one instance of `set_option` (and
+`try_assign`) per option *type*, rather than one per option name. */
+template <auto Member>
+void CommandLineOptions::set_member(
+    std::string_view curr_option_name,
+    std::string_view curr_option_value,
+    ArgumentVector::iterator &it,
+    bool bool_cluster,
+    bool value_after_equals
+) {
+    set_option_out_of_line(
+        this->*Member, curr_option_name, curr_option_value, it, bool_cluster, value_after_equals
+    );
+}
+
+namespace {
+
+/* The number of option names */
+constexpr auto num_option_names = with_option_names([](auto... names) {
+    return sizeof...(names);
+});
+
+}
+
 /* Given the option name `option_name` and value `option_value` from the command-line arguments,
 `try_processing `attempts to set the value of the option corresponding to `option_name` to the
 value given by `option_value`. It returns `true` if success occurs, `false` if no option's name
@@ -265,158 +727,569 @@ The iterator to the current argument `it` is passed in for use in error messages
 special handling logic within the boolean option case in  `try_assign`. `bool_cluster` (defaulted
 to `false`; see declaration) should be set to `true` if the current option is part of a cluster
 of single-character boolean options; it is used to provide more specific error messages in
-`try_set_option`. */
+`set_option`. `value_after_equals` (also defaulted to `false`) should be set to `true` if
+`option_value` was given after an `=` in the current argument; see `try_assign`. */
 auto CommandLineOptions::try_processing(
     std::string_view option_name,
     std::string_view option_value,
     auto &it,
-    bool bool_cluster
+    bool bool_cluster,
+    bool value_after_equals
 ) -> bool {
+    CPP_ARGUMENT_PARSER_PROFILE_PHASE(dispatch);
+
+#ifndef CPP_ARGUMENT_PARSER_LOOSE_NAMES
+    /* Option names are matched exactly, so the key of every option name is the name itself. */
+    static constexpr auto key_of = [](std::size_t, std::string_view name) { return name; };
+    auto option_key = option_name;
+#else
+    /* In loose name mode, option names are matched by their keys (see `fold_option_name`), so that
+    matching ignores case, `-` and `_`. The keys of all option names are computed once, at compile
+    time; only the key of `option_name` is computed here, into a buffer on the stack (or, for
+    names too long for it, into a `ParserString`, which only allocates in that case). */
+    static constexpr auto num_name_characters = with_option_names([](auto... names) {
+        return (names.name.size() + ... + 0);
+    });
+    static constexpr auto option_keys = with_option_names([](auto... names) {
+        return OptionKeys<num_name_characters, sizeof...(names)>(names...);
+    });
+    static constexpr auto key_of = [](std::size_t index, std::string_view) {
+        return option_keys[index];
+    };
+
+    std::array<char, std::max<std::size_t>(option_keys.max_size, 64)> key_buffer;
+    ParserString long_key_buffer(make_parser_allocator<char>(parse_stats_tracker));
+    auto key_characters = key_buffer.data();
+    if (option_name.size() > key_buffer.size()) {
+        long_key_buffer.resize(option_name.size());
+        key_characters = long_key_buffer.data();
+    }
+    auto option_key = std::string_view(
+        key_characters, fold_option_name(option_name, key_characters)
+    );
+#endif
+
+#ifndef CPP_ARGUMENT_PARSER_COMPACT_DISPATCH
     /* For every possible option name, try to set the corresponding option to the value given by
-    `option_value`. If a new option or option name is added, one single line needs to be added
-    to this function. */
-    return (try_set_option(nthreads, "nthreads", option_name, option_value, it, bool_cluster) ||
-            try_set_option(nthreads, "n", option_name, option_value, it, bool_cluster) ||
-            try_set_option(spp, "spp", option_name, option_value, it, bool_cluster) ||
-            try_set_option(seed, "seed", option_name, option_value, it, bool_cluster) ||
-            try_set_option(seed, "s", option_name, option_value, it, bool_cluster) ||
-            try_set_option(image_file, "imagefile", option_name, option_value, it, bool_cluster) ||
-            try_set_option(input_file, "input", option_name, option_value, it, bool_cluster) ||
-            try_set_option(quiet, "quiet", option_name, option_value, it, bool_cluster) ||
-            try_set_option(quiet, "q", option_name, option_value, it, bool_cluster) ||
-            try_set_option(log_util, "logutil", option_name, option_value, it, bool_cluster) ||
-            try_set_option(log_util, "l", option_name, option_value, it, bool_cluster) ||
-            try_set_option(partial, "partial", option_name, option_value, it, bool_cluster) ||
-            try_set_option(partial, "p", option_name, option_value, it, bool_cluster));
+    `option_value`. This instantiates (and inlines) `try_set_option` once per option name, which
+    gives the compiler the most room to optimize each comparison and conversion. `index` counts
+    the option names in order (the operands of `||` are evaluated from left to right). */
+    std::size_t index = 0;
+    auto found = with_option_names([&](auto... names) {
+        return (try_set_option(
+            this->*decltype(names)::member, key_of(index++, names.name), option_key, option_name,
+            option_value, it, bool_cluster, value_after_equals
+        ) || ...);
+    });
+    /* In the parser of a `PartialParse`, record that the option name was set */
+    if (found && partial_parse) {
+        partial_parse->set_names[index - 1] = true;
+    }
+    return found;
+#else
+    /* In compact dispatch mode, every option name is instead mapped to an `OptionDescriptor`
+    holding the key of the name and a pointer to the `set_member` thunk for its option, and we
+    look up the key of `option_name` in a (compile-time constant) index of the keys of the
+    descriptors (see src/nameindex.h, which `cap_getopt_long` shares). This keeps the code size
+    of dispatch independent of the number of option names. */
+    struct OptionDescriptor {
+        std::string_view key;
+        void (CommandLineOptions::*set)(
+            std::string_view, std::string_view, ArgumentVector::iterator &, bool, bool
+        );
+    };
+    static constexpr auto descriptors = with_option_names([](auto... names) {
+        std::size_t index = 0;
+        return std::array{OptionDescriptor{
+            key_of(index++, names.name), &CommandLineOptions::set_member<decltype(names)::member>
+        }...};
+    });
+
+    static constexpr auto key_index = [] {
+        std::array<IndexedName, descriptors.size()> names;
+        for (std::size_t i = 0; i < descriptors.size(); ++i) {
+            names[i] = IndexedName{descriptors[i].key, i};
+        }
+        sort_names(names);
+        return names;
+    }();
+
+    auto found = find_name(key_index, option_key);
+    if (!found) {
+        return false;
+    }
+    (this->*descriptors[found->position].set)(
+        option_name, option_value, it, bool_cluster, value_after_equals
+    );
+    /* In the parser of a `PartialParse`, record that the option name was set */
+    if (partial_parse) {
+        partial_parse->set_names[found->position] = true;
+    }
+    return true;
+#endif
 }
 
-CommandLineOptions::CommandLineOptions(int argc, char **argv) {
+/* Parses the option in the argument `*it`, setting the option it gives. If the option takes the
+argument after it as its value, `it` is advanced to that value. `end` is the end of all of the
+arguments. */
+void CommandLineOptions::parse_argument(
+    ArgumentVector::iterator &it,
+    ArgumentVector::iterator end
+) {
 
-    /* First, get the command-line arguments (excluding the first one, which is always the
-    executable itself) as a `std::vector<std::string>`, and store it in `arguments`. */
-    auto arguments = get_command_line_arguments(argc, argv);
-
-    /* Iterate over every non-executable command-line argument. */
-    for (auto it = arguments.begin(); it != arguments.end(); ++it) {
-
-        /* We define `curr_argument` as a `std::string_view` over the current argument `*it`. */
-        auto curr_argument = std::string_view(*it);
-
-        /* Find the number of dashes at the beginning of the current argument, and remove all
-        such prefix dashes from `curr_argument`. */
-        auto num_prefix_dashes = curr_argument.find_first_not_of('-');
-        curr_argument.remove_prefix(num_prefix_dashes);
-
-        /* We have several cases for `curr_argument`:
-        Case 1: `curr_argument` might not be an option at all; this occurs if it is prefixed by
-        zero dashes. In this case, we immediately raise an error, because we always will expect
-        `it` to point to an option at the start of every iteration in this `for`-loop.
-
-        Case 2: `curr_argument` was prefixed with exactly one dash, there were multiple characters
-        following that dash, and there either was no equal sign present, or the first '=' occurred
-        more than one character after the dashes.
-        An example of the first case is `-abcd`, and an example of the second case is `-abcd=[...]`.
-        Clearly, the second possibility is invalid, because single-dashes are used exclusively for
-        single-character options (e.g. `-a`), or a cluster of single-character boolean options
-        (e.g. `-abc`, where `a`, `b`, and `c` are all boolean options). The first case here
-        corresponds exactly to the case of a boolean option cluster; thus, we will need to set the
-        values of all the single-character options in the argument to `true` in that case.
-
-        Case 3: `curr_argument` was either prefixed with two dashes, or it was prefixed with one
-        dash and then followed by a single character and then possibly an equals sign.
-        This case is designed to capture all arguments that could represent a valid option-value
-        pair. Specifically, this case handles arguments of the form `--option=[value]`,
-        `-o=[value]`, `--option`, and `-o`. In the cases of `--option` and `-o`, we will expect to
-        find a value as the next argument, unless `option` is a boolean option, in which case a
-        value is optional (if no value is given, the boolean option will be set to true). */
-        if (auto equals_sign_index = curr_argument.find('='); num_prefix_dashes == 0) {
-            /* If the current argument was prefixed by zero dashes, then it is not a valid option
-            at all, and so we raise an error. */
-            print_then_exit("Error: Expected -[option] or --[option], got {}", *it);
-        } else if (num_prefix_dashes == 1 && curr_argument.size() > 1 && equals_sign_index > 1) {
-            /* Handle Case 2 (clusters of single-character boolean options). Note that the condition
-            `equals_sign_index > 1` implicitly includes `equals_sign_index == std::string::npos`,
-            because `std::string::npos` is defined as being the largest possible `size_t` value.
-            That is, `equals_sign_index > 1` will capture both the case when the first `=` occurs
-            more than one character after the prefix dashes, and the case where there is no `=`
-            in the current argument at all. */
-
-            /* If there is an equals sign in the string (e.g. `-abcd=[...]`), we know there is
-            an error, because single dashes are used exclusively for single-character options
-            (and `abcd` contains multiple characters), or for clusters of single-character
-            boolean options (in which case no value should be given; the argument should just
-            be `-abcd`). Thus, we raise an error in this case. */
-            if (equals_sign_index != std::string::npos) {
+    /* We define `curr_argument` as a `std::string_view` over the current argument `*it`. */
+    auto curr_argument = std::string_view(*it);
+
+    /* Find the number of dashes at the beginning of the current argument, and remove all
+    such prefix dashes from `curr_argument`. */
+    auto num_prefix_dashes = std::min(curr_argument.find_first_not_of('-'), curr_argument.size());
+    curr_argument.remove_prefix(num_prefix_dashes);
+
+    /* We have several cases for `curr_argument`:
+    Case 1: `curr_argument` might not be an option at all; this occurs if it is prefixed by
+    zero dashes, or if it consists only of dashes (e.g. `-` or `--`). In this case, we
+    immediately raise an error, because we always will expect `it` to point to an option at the
+    start of every iteration in this `for`-loop.
+
+    Case 2: `curr_argument` was prefixed with exactly one dash, there were multiple characters
+    following that dash, and there either was no equal sign present, or the first '=' occurred
+    more than one character after the dashes.
+    An example of the first case is `-abcd`, and an example of the second case is `-abcd=[...]`.
+    Clearly, the second possibility is invalid, because single-dashes are used exclusively for
+    single-character options (e.g. `-a`), or a cluster of single-character boolean options
+    (e.g. `-abc`, where `a`, `b`, and `c` are all boolean options). The first case here
+    corresponds exactly to the case of a boolean option cluster; thus, we will need to set the
+    values of all the single-character options in the argument to `true` in that case.
+
+    Case 3: `curr_argument` was either prefixed with two dashes, or it was prefixed with one
+    dash and then followed by a single character and then possibly an equals sign.
+    This case is designed to capture all arguments that could represent a valid option-value
+    pair. Specifically, this case handles arguments of the form `--option=[value]`,
+    `-o=[value]`, `--option`, and `-o`. In the cases of `--option` and `-o`, we will expect to
+    find a value as the next argument, unless `option` is a boolean option, in which case a
+    value is optional (if no value is given, the boolean option will be set to true). */
+    if (auto equals_sign_index = curr_argument.find('=');
+        num_prefix_dashes == 0 || curr_argument.empty()) {
+        /* If the current argument was prefixed by zero dashes (or is nothing but dashes),
+        then it is not a valid option at all, and so we raise an error. */
+        print_then_exit("Error: Expected -[option] or --[option], got {}", *it);
+    } else if (num_prefix_dashes == 1 && curr_argument.size() > 1 && equals_sign_index > 1) {
+        /* Handle Case 2 (clusters of single-character boolean options). Note that the condition
+        `equals_sign_index > 1` implicitly includes `equals_sign_index == std::string::npos`,
+        because `std::string::npos` is defined as being the largest possible `size_t` value.
+        That is, `equals_sign_index > 1` will capture both the case when the first `=` occurs
+        more than one character after the prefix dashes, and the case where there is no `=`
+        in the current argument at all. */
+
+        /* If there is an equals sign in the string (e.g. `-abcd=[...]`), we know there is
+        an error, because single dashes are used exclusively for single-character options
+        (and `abcd` contains multiple characters), or for clusters of single-character
+        boolean options (in which case no value should be given; the argument should just
+        be `-abcd`). Thus, we raise an error in this case. */
+        if (equals_sign_index != std::string::npos) {
+            print_then_exit(
+                "Error: Unrecognized option {} in -{}\nHelp: Single dashes are used "
+                "for either one single-character option (e.g. cmd -n 5),\nor for multiple "
+                "single-character boolean options. Did you mean to use two dashes\ninstead "
+                "of one?",
+                curr_argument.substr(0, equals_sign_index),
+                curr_argument
+            );
+        }
+
+        /* Otherwise, we have a cluster of single-character boolean options, such as `-abcd`.
+        These are equivalent to setting every individual single-character boolean option to
+        true. So, we loop through all characters of `curr_argument`, and call
+        `try_processing` on each one. */
+        for (char option_name : curr_argument) {
+            /* `std::string_view(&option_name, 1)` looks odd, but it is a way to create
+            a `std::string_view` over a single character. Additionally, note that (a)
+            we pass in an empty string to the `option_value` parameter of `try_processing`,
+            denoting that the user did not explicitly provide a value for the current
+            option, and that (b) we set the `bool_cluster` parameter to true. This turns
+            on a requirement that the type of the option be boolean; if not, a detailed
+            error message will be raised. */
+            if (!try_processing(std::string_view(&option_name, 1), "", it, true)) {
                 print_then_exit(
-                    "Error: Unrecognized option {} in -{}\nHelp: Single dashes are used "
-                    "for either one single-character option (e.g. cmd -n 5),\nor for multiple "
-                    "single-character boolean options. Did you mean to use two dashes\ninstead "
-                    "of one?",
-                    curr_argument.substr(0, equals_sign_index),
-                    curr_argument
+                    "Error: Unrecognized option {} in -{}",
+                    option_name, curr_argument
                 );
             }
+        }
+    } else {
 
-            /* Otherwise, we have a cluster of single-character boolean options, such as `-abcd`.
-            These are equivalent to setting every individual single-character boolean option to
-            true. So, we loop through all characters of `curr_argument`, and call
-            `try_processing` on each one. */
-            for (char option_name : curr_argument) {
-                /* `std::string_view(&option_name, 1)` looks odd, but it is a way to create
-                a `std::string_view` over a single character. Additionally, note that (a)
-                we pass in an empty string to the `option_value` parameter of `try_processing`,
-                denoting that the user did not explicitly provide a value for the current
-                option, and that (b) we set the `bool_cluster` parameter to true. This turns
-                on a requirement that the type of the option be boolean; if not, a detailed
-                error message will be raised. */
-                if (!try_processing(std::string_view(&option_name, 1), "", it, true)) {
-                    print_then_exit(
-                        "Error: Unrecognized option {} in -{}",
-                        option_name, curr_argument
-                    );
-                }
-            }
+        /* Extract the name of the current argument's option, and the value we should set that
+        option to. */
+        std::string_view option_name, option_value;
+        if (equals_sign_index != std::string::npos) {
+            /* If the current argument contains a `=`, then we are looking for the cases
+            of an option followed by an equal sign and then followed by its value, all
+            in the same string (e.g. `--nthreads=4` or `-n=4`). In this case, after
+            the prefix dashes have been stripped out, the option name and value from the
+            current argument are simply the substrings before and after the `=` sign. */
+            option_name = curr_argument.substr(0, equals_sign_index);
+            option_value = curr_argument.substr(equals_sign_index + 1);
         } else {
+            /* If the current argument contains no equals sign, then we either have a
+            boolean option with no value given (in which case the option is automatically
+            set to `true`), or an option whose value is given as the next argument (e.g.
+            `--nthreads 4`, `-n 4`, `--quiet 1`, etc). In this case, after removing prefix
+            dashes from the current argument, the option name is simply given by the current
+            argument, while the option value is given by the next argument. If there is no
+            next argument, we set `option_value` to the empty string; this is checked in
+            the functions called from `try_processing`. */
+            option_name = curr_argument;
+            option_value = (std::next(it) != end ? *std::next(it) : ""sv);
+        }
 
-            /* Extract the name of the current argument's option, and the value we should set that
-            option to. */
-            std::string_view option_name, option_value;
-            if (equals_sign_index != std::string::npos) {
-                /* If the current argument contains a `=`, then we are looking for the cases
-                of an option followed by an equal sign and then followed by its value, all
-                in the same string (e.g. `--nthreads=4` or `-n=4`). In this case, after
-                the prefix dashes have been stripped out, the option name and value from the
-                current argument are simply the substrings before and after the `=` sign. */
-                option_name = curr_argument.substr(0, equals_sign_index);
-                option_value = curr_argument.substr(equals_sign_index + 1);
-            } else {
-                /* If the current argument contains no equals sign, then we either have a
-                boolean option with no value given (in which case the option is automatically
-                set to `true`), or an option whose value is given as the next argument (e.g.
-                `--nthreads 4`, `-n 4`, `--quiet 1`, etc). In this case, after removing prefix
-                dashes from the current argument, the option name is simply given by the current
-                argument, while the option value is given by the next argument. If there is no
-                next argument, we set `option_value` to the empty string; this is checked in
-                the functions called from `try_processing`. */
-                option_name = curr_argument;
-                option_value = (std::next(it) != arguments.end() ? *std::next(it) : ""sv);
-            }
+        auto value_after_equals = equals_sign_index != std::string::npos;
+        if (!try_processing(option_name, option_value, it, false, value_after_equals)) {
+            print_then_exit("Error: Unrecognized option {}", option_name);
+        }
 
+        /* Increment it again if we used two arguments just now */
+        /* If the option name and value were given as two separate arguments, then we
+        actually consumed two command-line arguments to initialize the current option, and
+        so we need to increment `it` an extra time. This occurs when the current argument
+        contained no equals sign, and when there was a next command-line argument (unless
+        the option was a boolean option and the next command-line argument was the next
+        option, which is a case we handle in the `try_assign` function; see above). */
+        if (equals_sign_index == std::string::npos && !option_value.empty()) {
+            ++it;
+        }
+    }
+}
 
-            if (!try_processing(option_name, option_value, it)) {
-                print_then_exit("Error: Unrecognized option {}", option_name);
-            }
+/* Parses the options in the arguments from `first` up to (but not including) `last`, setting
+the options they give, and returns the iterator one past the last argument consumed. This is
+`last`, unless the last option took `*last` as its value, in which case it is the argument after
+`last`. `end` is the end of all of the arguments, so that the last option can look past `last`
+for its value. */
+auto CommandLineOptions::parse_arguments(
+    ArgumentVector::iterator first,
+    ArgumentVector::iterator last,
+    ArgumentVector::iterator end
+) -> ArgumentVector::iterator {
+    /* Iterate over every argument from `first` to `last`. (The comparison is `it < last` rather
+    than `it != last`, because the last option may take `*last` as its value.) */
+    auto it = first;
+    for (; it < last; ++it) {
+#ifndef CPP_ARGUMENT_PARSER_COLLECT_ERRORS
+        parse_argument(it, end);
+#else
+        if (!diagnostics) {
+            parse_argument(it, end);
+            continue;
+        }
 
-            /* Increment it again if we used two arguments just now */
-            /* If the option name and value were given as two separate arguments, then we
-            actually consumed two command-line arguments to initialize the current option, and
-            so we need to increment `it` an extra time. This occurs when the current argument
-            contained no equals sign, and when there was a next command-line argument (unless
-            the option was a boolean option and the next command-line argument was the next
-            option, which is a case we handle in the `try_assign` function; see above). */
-            if (equals_sign_index == std::string::npos && !option_value.empty()) {
+        /* When errors are collected, an error in the current argument is added to `diagnostics`,
+        and parsing resumes with the next option: if the erroneous argument may have taken the
+        argument after it as its value (see `may_take_value`), and that argument does not start an
+        option, it is skipped as well. (This is where a parallel parse may split the arguments into
+        chunks, so that the same errors are collected however the arguments are parsed.) */
+        try {
+            parse_argument(it, end);
+        } catch (const DiagnosticBuffer::Resume &error) {
+            diagnostics->add(
+                diagnostics->first_argument_index + static_cast<std::size_t>(it - first),
+                option_name_of(*it),
+                error.message
+            );
+            if (may_take_value(*it) && std::next(it) != end && !std::next(it)->empty() &&
+                std::next(it)->front() != '-') {
                 ++it;
             }
         }
+#endif
     }
+
+    return it;
+}
+
+/* Parses the arguments of `parse` into its options (with the parser of `parse` recording the
+option names it sets, and storing the first error instead of reporting it). `end` is the end of all
+of the arguments, so that the last option can look past `parse.last` for its value. */
+void CommandLineOptions::parse_partially(PartialParse &parse, ArgumentVector::iterator end) {
+    parse.options.partial_parse = &parse;
+#ifdef CPP_ARGUMENT_PARSER_COLLECT_ERRORS
+    parse.options.diagnostics = &parse.diagnostics;
+#endif
+    try {
+        parse.options.parse_arguments(parse.first, parse.last, end);
+    } catch (const PartialParse::Stop &) {
+        /* The error is in `parse.error` */
+    }
+}
+
+/* Reports the error raised in `parse`, if there was one. Otherwise, sets every option that was set
+in `parse` to its value there (so that, applying the `PartialParse`s of consecutive arguments in
+order, the option given last wins), and returns the options whose values changed. The parse
+statistics of the parser of `parse` are added to those of this parser. If errors are collected, the
+errors in `parse` are added to `diagnostics` instead of being reported, and no option is set. */
+auto CommandLineOptions::apply_partial_parse(PartialParse &parse) -> OptionChanges {
+#ifdef CPP_ARGUMENT_PARSER_COLLECT_ERRORS
+    if (!parse.diagnostics.empty()) {
+        diagnostics->append(parse.diagnostics);
+        parse_stats_tracker.merge(parse.options.parse_stats());
+        return {};
+    }
+#endif
+    if (parse.error) {
+        print_then_exit("{}", *parse.error);
+    }
+
+    OptionChanges changes;
+    with_option_names([&](auto... names) {
+        std::size_t index = 0;
+        ([&](auto name) {
+            constexpr auto member = decltype(name)::member;
+            if (parse.set_names[index++] && !(this->*member == parse.options.*member)) {
+                this->*member = parse.options.*member;
+                changes.changed_options.push_back(&option_tag<member>);
+            }
+        }(names), ...);
+    });
+    parse_stats_tracker.merge(parse.options.parse_stats());
+    return changes;
+}
+
+#ifdef CPP_ARGUMENT_PARSER_COLLECT_ERRORS
+/* Stops collecting errors in `buffer`, and reports them together, if there were any: their
+messages are printed in the order of their arguments, one per line, before exiting the program,
+or, if `CPP_ARGUMENT_PARSER_THROW_ON_ERROR` is defined, they are thrown as one
+`CommandLineOptionsError` holding both that text and the `ParseDiagnostic`s of the errors. */
+void CommandLineOptions::report_diagnostics(DiagnosticBuffer &buffer) {
+    diagnostics = nullptr;
+    if (buffer.empty()) {
+        return;
+    }
+
+    ParserString report(make_parser_allocator<char>(parse_stats_tracker));
+    buffer.append_report(report);
+
+#ifdef CPP_ARGUMENT_PARSER_THROW_ON_ERROR
+    std::vector<ParseDiagnostic> parse_diagnostics;
+    parse_diagnostics.reserve(buffer.entries.size());
+    for (const auto &entry : buffer.entries) {
+        parse_diagnostics.push_back({
+            entry.argument_index,
+            std::string(buffer.option(entry)),
+            std::string(buffer.message(entry))
+        });
+    }
+    throw CommandLineOptionsError(
+        std::string(report.data(), report.size()), std::move(parse_diagnostics)
+    );
+#else
+    print_then_exit("{}", std::string_view(report));
+#endif
+}
+#endif
+
+auto CommandLineOptions::apply(std::span<const std::string_view> delta_arguments) -> OptionChanges {
+    ArgumentVector arguments(make_parser_allocator<std::string_view>(parse_stats_tracker));
+    arguments.reserve(delta_arguments.size());
+    for (auto argument : delta_arguments) {
+#ifdef CPP_ARGUMENT_PARSER_VALIDATE_UTF8
+        /* Check that the arguments are valid UTF-8, as in `get_command_line_arguments` */
+        if (auto invalid_offset = find_invalid_utf8(argument);
+            invalid_offset != std::string_view::npos) {
+            print_then_exit(
+                invalid_utf8_message,
+                arguments.size() + 1,
+                static_cast<unsigned>(static_cast<unsigned char>(argument[invalid_offset])),
+                invalid_offset
+            );
+        }
+#endif
+        arguments.push_back(argument);
+    }
+
+    /* Parse the arguments into a `PartialParse`, so that no option of this parser is changed if
+    there is an error in them, and only the options they set are compared and applied. */
+    PartialParse delta(
+        arguments.begin(), arguments.end(), 0, num_option_names, parse_stats_tracker
+    );
+    parse_partially(delta, arguments.end());
+#ifndef CPP_ARGUMENT_PARSER_COLLECT_ERRORS
+    return apply_partial_parse(delta);
+#else
+    DiagnosticBuffer delta_diagnostics(1, parse_stats_tracker);
+    diagnostics = &delta_diagnostics;
+    auto changes = apply_partial_parse(delta);
+    report_diagnostics(delta_diagnostics);
+    return changes;
+#endif
+}
+
+auto CommandLineOptions::try_parse(
+    std::span<const std::string_view> arguments,
+    std::string &error
+) -> std::optional<CommandLineOptions> {
+    CommandLineOptions options;
+    ArgumentVector parsed_arguments(
+        make_parser_allocator<std::string_view>(options.parse_stats_tracker)
+    );
+    parsed_arguments.reserve(arguments.size());
+    for (auto argument : arguments) {
+#ifdef CPP_ARGUMENT_PARSER_VALIDATE_UTF8
+        if (auto invalid_offset = find_invalid_utf8(argument);
+            invalid_offset != std::string_view::npos) {
+            error = std::format(
+                invalid_utf8_message,
+                parsed_arguments.size() + 1,
+                static_cast<unsigned>(static_cast<unsigned char>(argument[invalid_offset])),
+                invalid_offset
+            );
+            return std::nullopt;
+        }
+#endif
+        parsed_arguments.push_back(argument);
+    }
+
+    /* Parse the arguments into a `PartialParse`, which stores its errors instead of reporting
+    them, and apply it to the default options if there were none. */
+    PartialParse parse(
+        parsed_arguments.begin(), parsed_arguments.end(), 0, num_option_names,
+        options.parse_stats_tracker
+    );
+    parse_partially(parse, parsed_arguments.end());
+#ifdef CPP_ARGUMENT_PARSER_COLLECT_ERRORS
+    if (!parse.diagnostics.empty()) {
+        ParserString report(make_parser_allocator<char>(options.parse_stats_tracker));
+        parse.diagnostics.append_report(report);
+        error.assign(report.data(), report.size());
+        return std::nullopt;
+    }
+#endif
+    if (parse.error) {
+        error = std::move(*parse.error);
+        return std::nullopt;
+    }
+    options.apply_partial_parse(parse);
+    return options;
+}
+
+#ifdef CPP_ARGUMENT_PARSER_PARALLEL_PARSE
+namespace {
+
+/* The smallest number of arguments in each chunk of a parallel parse. Parsing an argument takes
+tens of nanoseconds, so smaller chunks would take less time to parse than it takes to start a
+thread for them. */
+constexpr std::size_t parallel_parse_min_chunk_size = 16384;
+
+/* The smallest number of threads that a parallel parse assumes the machine has. The unit tests
+(which define `CPP_ARGUMENT_PARSER_TESTING`) compare parallel parses with sequential ones, so their
+arguments must be split into chunks even on a machine with a single hardware thread. */
+#ifdef CPP_ARGUMENT_PARSER_TESTING
+constexpr unsigned parallel_parse_min_threads = 4;
+#else
+constexpr unsigned parallel_parse_min_threads = 1;
+#endif
+
+}
+
+/* Parses `arguments` in chunks on several threads, if there are enough of them for that to be
+faster; otherwise, parses them with `parse_arguments`.
+
+Whether an argument starts an option or is the value of the option before it depends on all of
+the arguments before it, so the arguments cannot be split into chunks just anywhere. Instead, the
+chunks are split only where the argument before the split cannot take the argument after it as its
+value (see `may_take_value`): each chunk then starts with an option, as it would have in a
+sequential parse, so the chunks can be tokenized, and their values converted, independently.
+
+Each chunk is parsed as its own `PartialParse`, which records which option names were set in the
+chunk. Then, the chunks are applied in their original order: if an error was raised in a chunk,
+it is reported (as the first error of the chunk that comes first, it is the error that a
+sequential parse would have reported), and otherwise, the options set in the chunk are copied to
+this parser, so that the option given last still wins. */
+void CommandLineOptions::parse_in_parallel(ArgumentVector &arguments) {
+    auto num_chunks = std::min<std::size_t>(
+        std::max(std::thread::hardware_concurrency(), parallel_parse_min_threads),
+        arguments.size() / parallel_parse_min_chunk_size
+    );
+    if (num_chunks < 2) {
+        parse_arguments(arguments.begin(), arguments.end(), arguments.end());
+        return;
+    }
+
+    /* Split the arguments into (at most) `num_chunks` chunks of about the same size, moving the
+    end of each chunk forward until it is a valid split. */
+    std::vector<PartialParse, ParserAllocator<PartialParse>> chunks(
+        make_parser_allocator<PartialParse>(parse_stats_tracker)
+    );
+    chunks.reserve(num_chunks);
+    for (auto first = arguments.begin(); first != arguments.end();) {
+        auto chunk_index = static_cast<std::ptrdiff_t>(chunks.size() + 1);
+        auto last = std::max(
+            arguments.begin() + chunk_index * std::ssize(arguments) /
+                static_cast<std::ptrdiff_t>(num_chunks),
+            std::next(first)
+        );
+        while (last != arguments.end() && may_take_value(*std::prev(last))) {
+            ++last;
+        }
+        chunks.emplace_back(
+            first, last, first - arguments.begin(), num_option_names, parse_stats_tracker
+        );
+        first = last;
+    }
+
+    /* Parse the first chunk on this thread, and the others on one thread each (the threads are
+    joined when `workers` is destroyed). */
+    {
+        std::vector<std::jthread> workers;
+        workers.reserve(chunks.size() - 1);
+        for (auto chunk = std::next(chunks.begin()); chunk != chunks.end(); ++chunk) {
+            workers.emplace_back(parse_partially, std::ref(*chunk), arguments.end());
+        }
+        parse_partially(chunks.front(), arguments.end());
+    }
+
+    /* Apply the chunks in order */
+    for (auto &chunk : chunks) {
+        apply_partial_parse(chunk);
+    }
+}
+#endif
+
+CommandLineOptions::CommandLineOptions(int argc, char **argv) {
+#ifdef CPP_ARGUMENT_PARSER_INSTRUMENTATION
+    /* In instrumented builds, record the time and allocations spent in each phase of parsing
+    (see src/parseprofile.h). Everything not inside another phase is charged to tokenization. */
+    ParseProfile profile(parse_stats_tracker);
+#endif
+
+    /* First, get the command-line arguments (excluding the first one, which is always the
+    executable itself) as an `ArgumentVector`, and store it in `arguments`. */
+    ParserString argument_text(make_parser_allocator<char>(parse_stats_tracker));
+    auto arguments = get_command_line_arguments(argc, argv, argument_text);
+
+#ifdef CPP_ARGUMENT_PARSER_COLLECT_ERRORS
+    /* Collect the errors in the options, rather than stopping at the first one (errors in the
+    encoding of the arguments, above, are still reported immediately). */
+    DiagnosticBuffer argument_diagnostics(1, parse_stats_tracker);
+    diagnostics = &argument_diagnostics;
+#endif
+
+    /* Then, parse the options in the arguments. */
+#ifndef CPP_ARGUMENT_PARSER_PARALLEL_PARSE
+    parse_arguments(arguments.begin(), arguments.end(), arguments.end());
+#else
+    parse_in_parallel(arguments);
+#endif
+
+#ifdef CPP_ARGUMENT_PARSER_COLLECT_ERRORS
+    report_diagnostics(argument_diagnostics);
+#endif
+
+#ifdef CPP_ARGUMENT_PARSER_INSTRUMENTATION
+    /* If the user asked for utilization logging, report the parse profile as one line of
+    `key=value` pairs on `stderr` (so that it never mixes with the program's normal output). */
+    if (log_util) {
+        write_stderr(profile.report());
+        write_stderr("\n");
+        flush_output();
+    }
+#endif
 }
\ No newline at end of file
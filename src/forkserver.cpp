@@ -0,0 +1,340 @@
+#include "forkserver.h"
+#include "output.h"
+#include <cerrno>
+#include <csignal>
+#include <cstdint>
+#include <cstring>
+#include <exception>
+#include <format>
+#include <optional>
+#include <string>
+#include <vector>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace {
+
+/* Writes to sockets never raise `SIGPIPE` in the client (whose signal handlers are its own), where
+the platform allows that; the server ignores `SIGPIPE` instead. */
+#ifdef MSG_NOSIGNAL
+constexpr int send_flags = MSG_NOSIGNAL;
+#else
+constexpr int send_flags = 0;
+#endif
+
+/* Writes the `size` bytes at `data` to the file descriptor `fd` (with `send` if `is_socket`),
+retrying after interruptions and partial writes. Returns whether all of them were written. */
+auto write_all(int fd, const void *data, std::size_t size, bool is_socket) -> bool {
+    auto bytes = static_cast<const char *>(data);
+    while (size > 0) {
+        auto count = is_socket ? ::send(fd, bytes, size, send_flags) : ::write(fd, bytes, size);
+        if (count < 0 && errno == EINTR) {
+            continue;
+        } else if (count <= 0) {
+            return false;
+        }
+        bytes += count;
+        size -= static_cast<std::size_t>(count);
+    }
+    return true;
+}
+
+/* Reads `size` bytes from `fd` into `data`, retrying after interruptions and partial reads.
+Returns whether all of them were read (and not the end of the stream, or an error). */
+auto read_all(int fd, void *data, std::size_t size) -> bool {
+    auto bytes = static_cast<char *>(data);
+    while (size > 0) {
+        auto count = ::read(fd, bytes, size);
+        if (count < 0 && errno == EINTR) {
+            continue;
+        } else if (count <= 0) {
+            return false;
+        }
+        bytes += count;
+        size -= static_cast<std::size_t>(count);
+    }
+    return true;
+}
+
+/* Sets the close-on-exec flag of `fd`, so that it is not inherited by programs that jobs run */
+void set_close_on_exec(int fd) {
+    ::fcntl(fd, F_SETFD, ::fcntl(fd, F_GETFD) | FD_CLOEXEC);
+}
+
+/* Returns the address of the Unix socket at `socket_path`, or `std::nullopt` if the path is too
+long for one */
+auto socket_address(const char *socket_path) -> std::optional<sockaddr_un> {
+    sockaddr_un address = {};
+    address.sun_family = AF_UNIX;
+    auto path_size = std::strlen(socket_path);
+    if (path_size >= sizeof(address.sun_path)) {
+        return std::nullopt;
+    }
+    std::memcpy(address.sun_path, socket_path, path_size + 1);
+    return address;
+}
+
+/* Sends the exit status `status` of a job over `connection` */
+void send_status(int connection, int status) {
+    auto status_to_send = static_cast<std::int32_t>(status);
+    write_all(connection, &status_to_send, sizeof(status_to_send), true);
+}
+
+/* Receives the size of the arguments of a job and the client's `stdout` and `stderr` (step 1 of
+the protocol in include/forkserver.h) from `connection`. Returns whether they were received; if
+they were not, no file descriptors are left open. */
+auto receive_request_header(
+    int connection,
+    std::uint32_t &arguments_size,
+    int (&client_fds)[2]
+) -> bool {
+    alignas(cmsghdr) char control[CMSG_SPACE(sizeof(client_fds))] = {};
+    iovec data = {&arguments_size, sizeof(arguments_size)};
+    msghdr message = {};
+    message.msg_iov = &data;
+    message.msg_iovlen = 1;
+    message.msg_control = control;
+    message.msg_controllen = sizeof(control);
+
+    ssize_t count;
+    do {
+        count = ::recvmsg(connection, &message, 0);
+    } while (count < 0 && errno == EINTR);
+    if (count <= 0) {
+        return false;
+    }
+
+    /* Take every file descriptor that was sent, so that none of them are leaked, and accept the
+    request only if there were exactly two. */
+    std::vector<int> received_fds;
+    for (auto header = CMSG_FIRSTHDR(&message); header; header = CMSG_NXTHDR(&message, header)) {
+        if (header->cmsg_level == SOL_SOCKET && header->cmsg_type == SCM_RIGHTS) {
+            auto num_fds = (header->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+            for (std::size_t i = 0; i < num_fds; ++i) {
+                int fd;
+                std::memcpy(&fd, CMSG_DATA(header) + i * sizeof(int), sizeof(int));
+                set_close_on_exec(fd);
+                received_fds.push_back(fd);
+            }
+        }
+    }
+    auto remaining = sizeof(arguments_size) - static_cast<std::size_t>(count);
+    if (received_fds.size() != 2 || (message.msg_flags & MSG_CTRUNC) ||
+        !read_all(connection, reinterpret_cast<char *>(&arguments_size) + count, remaining)) {
+        for (int fd : received_fds) {
+            ::close(fd);
+        }
+        return false;
+    }
+    client_fds[0] = received_fds[0];
+    client_fds[1] = received_fds[1];
+    return true;
+}
+
+/* Runs a job with the options `options` in the child forked for it: the child writes to the
+client's `stdout` and `stderr` (`client_fds`), and sends the exit status of the job over
+`connection` when it is done. */
+[[noreturn]] void run_job(
+    int listener,
+    int connection,
+    const int (&client_fds)[2],
+    const CommandLineOptions &options,
+    const std::function<int(const CommandLineOptions &)> &job
+) {
+    ::close(listener);
+    std::signal(SIGCHLD, SIG_DFL);
+    std::signal(SIGPIPE, SIG_DFL);
+    ::dup2(client_fds[0], STDOUT_FILENO);
+    ::dup2(client_fds[1], STDERR_FILENO);
+    ::close(client_fds[0]);
+    ::close(client_fds[1]);
+
+    /* A job that throws fails with exit status 255, like a job with an error in its arguments. The
+    exception must not unwind out of this function, because the child would then go on serving
+    requests on `listener` as if it were the server. */
+    int status = 255;
+    try {
+        status = job(options) & 0xff;
+    } catch (const std::exception &exception) {
+        write_stderr(std::format("Error: The job failed: {}\n", exception.what()));
+    } catch (...) {
+        write_stderr("Error: The job failed with an exception\n");
+    }
+    flush_output();
+    send_status(connection, status);
+
+    /* The child must not run the exit handlers (or the destructors of the global objects) of the
+    server, which it shares. */
+    ::_exit(status);
+}
+
+/* Handles one request from a client on `connection` (see the protocol in include/forkserver.h) */
+void serve_request(
+    int listener,
+    int connection,
+    const std::function<int(const CommandLineOptions &)> &job
+) {
+    std::uint32_t arguments_size;
+    int client_fds[2];
+    if (!receive_request_header(connection, arguments_size, client_fds)) {
+        return;
+    }
+
+    /* Receive the arguments, and split them at their NUL characters */
+    std::string arguments_text;
+    std::vector<std::string_view> arguments;
+    bool received = arguments_size <= fork_server_max_arguments_size;
+    if (received) {
+        arguments_text.resize(arguments_size);
+        received = read_all(connection, arguments_text.data(), arguments_text.size()) &&
+            (arguments_text.empty() || arguments_text.back() == '\0');
+    }
+    if (received) {
+        for (std::size_t start = 0; start < arguments_text.size();) {
+            auto end = arguments_text.find('\0', start);
+            arguments.push_back(std::string_view(arguments_text).substr(start, end - start));
+            start = end + 1;
+        }
+
+        /* Parse the arguments here, so that the child starts with its options already parsed, and
+        an error in them costs no fork. */
+        std::string error;
+        if (auto options = CommandLineOptions::try_parse(arguments, error)) {
+            /* Anything the server has buffered for its own output must not be written again by
+            the child */
+            flush_output();
+            auto child = ::fork();
+            if (child == 0) {
+                run_job(listener, connection, client_fds, *options, job);
+            } else if (child < 0) {
+                /* The job cannot run, so it fails as if there were an error in its arguments */
+                auto message = std::format(
+                    "Error: Cannot start the job: {}\n", std::strerror(errno)
+                );
+                write_all(client_fds[1], message.data(), message.size(), false);
+                send_status(connection, 255);
+            }
+        } else {
+            error.push_back('\n');
+            write_all(client_fds[0], error.data(), error.size(), false);
+            send_status(connection, 255);
+        }
+    }
+
+    ::close(client_fds[0]);
+    ::close(client_fds[1]);
+}
+
+}
+
+auto run_fork_server(
+    const char *socket_path,
+    const std::function<int(const CommandLineOptions &)> &job
+) -> int {
+    auto address = socket_address(socket_path);
+    if (!address) {
+        return ENAMETOOLONG;
+    }
+
+    int listener = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listener < 0) {
+        return errno;
+    }
+    set_close_on_exec(listener);
+    ::unlink(socket_path);
+    if (::bind(listener, reinterpret_cast<const sockaddr *>(&*address), sizeof(*address)) < 0 ||
+        ::listen(listener, SOMAXCONN) < 0) {
+        auto error = errno;
+        ::close(listener);
+        return error;
+    }
+
+    /* Children are reaped automatically, and writes to clients that are gone fail with `EPIPE`
+    rather than killing the server. */
+    std::signal(SIGCHLD, SIG_IGN);
+    std::signal(SIGPIPE, SIG_IGN);
+
+    while (true) {
+        int connection = ::accept(listener, nullptr, nullptr);
+        if (connection < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) {
+                continue;
+            }
+            auto error = errno;
+            ::close(listener);
+            return error;
+        }
+        set_close_on_exec(connection);
+
+        /* Requests are served one at a time, so a client that stops sending its request is
+        disconnected after a while, rather than keeping the server from serving other clients */
+        timeval timeout = {fork_server_receive_timeout_seconds, 0};
+        ::setsockopt(connection, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+        serve_request(listener, connection, job);
+        ::close(connection);
+    }
+}
+
+auto run_fork_server_job(
+    const char *socket_path,
+    std::span<const std::string_view> arguments
+) -> int {
+    std::string arguments_text;
+    for (auto argument : arguments) {
+        arguments_text.append(argument);
+        arguments_text.push_back('\0');
+    }
+    auto address = socket_address(socket_path);
+    if (!address || arguments_text.size() > fork_server_max_arguments_size) {
+        return -1;
+    }
+
+    int connection = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (connection < 0) {
+        return -1;
+    }
+    auto connected = ::connect(
+        connection, reinterpret_cast<const sockaddr *>(&*address), sizeof(*address)
+    );
+    if (connected < 0) {
+        ::close(connection);
+        return -1;
+    }
+
+    /* Send the size of the arguments, with `stdout` and `stderr` */
+    auto arguments_size = static_cast<std::uint32_t>(arguments_text.size());
+    const int client_fds[2] = {STDOUT_FILENO, STDERR_FILENO};
+    alignas(cmsghdr) char control[CMSG_SPACE(sizeof(client_fds))] = {};
+    iovec data = {&arguments_size, sizeof(arguments_size)};
+    msghdr message = {};
+    message.msg_iov = &data;
+    message.msg_iovlen = 1;
+    message.msg_control = control;
+    message.msg_controllen = sizeof(control);
+    auto header = CMSG_FIRSTHDR(&message);
+    header->cmsg_level = SOL_SOCKET;
+    header->cmsg_type = SCM_RIGHTS;
+    header->cmsg_len = CMSG_LEN(sizeof(client_fds));
+    std::memcpy(CMSG_DATA(header), client_fds, sizeof(client_fds));
+
+    /* Anything this process has buffered must be written before the job writes its output */
+    flush_output();
+
+    ssize_t count;
+    do {
+        count = ::sendmsg(connection, &message, send_flags);
+    } while (count < 0 && errno == EINTR);
+
+    /* Send the arguments, and wait for the exit status */
+    std::int32_t status;
+    auto remaining = sizeof(arguments_size) - static_cast<std::size_t>(count < 0 ? 0 : count);
+    bool succeeded = count > 0 &&
+        write_all(connection, reinterpret_cast<char *>(&arguments_size) + count, remaining, true) &&
+        write_all(connection, arguments_text.data(), arguments_text.size(), true) &&
+        read_all(connection, &status, sizeof(status));
+    ::close(connection);
+    return succeeded ? status : -1;
+}
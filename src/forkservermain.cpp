@@ -0,0 +1,31 @@
+#include "forkserver.h"
+#include "output.h"
+#include <cstring>
+#include <string_view>
+#include <vector>
+
+/* `cpp_argument_parser_forkserver serve SOCKET` runs a fork server on the Unix socket `SOCKET`,
+whose jobs print their options like `cpp_argument_parser` does, and
+`cpp_argument_parser_forkserver run SOCKET [ARGUMENTS...]` runs one job with the arguments
+`ARGUMENTS...` on that server, and exits with the exit status of the job. */
+int main(int argc, char** argv)
+{
+    auto command = std::string_view(argc >= 3 ? argv[1] : "");
+    if (command == "serve") {
+        auto error = run_fork_server(argv[2], [](const CommandLineOptions &options) {
+            write_stdout(std::format("Parsed options: {}", options));
+            return 0;
+        });
+        write_stderr(std::format("Error: Cannot serve on {}: {}\n", argv[2], std::strerror(error)));
+        flush_output();
+        return 1;
+    } else if (command == "run") {
+        std::vector<std::string_view> arguments(argv + 3, argv + argc);
+        return run_fork_server_job(argv[2], arguments);
+    }
+
+    write_stderr("Usage: cpp_argument_parser_forkserver serve SOCKET\n"
+                 "       cpp_argument_parser_forkserver run SOCKET [ARGUMENTS...]\n");
+    flush_output();
+    return 2;
+}
@@ -0,0 +1,392 @@
+#include "getopt_compat.h"
+#include "nameindex.h"
+#include "output.h"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <format>
+#include <iterator>
+#include <span>
+#include <string_view>
+#include <vector>
+
+/* The implementation follows glibc's `getopt_long` closely (including the order in which state
+is updated), so that C tools switching to `cap_getopt_long` see identical results, `cap_optind`
+values, and error messages. Error messages are written with `write_stderr`, like all other output
+of the parser (see include/output.h). See include/getopt_compat.h. */
+
+char *cap_optarg = nullptr;
+int cap_optind = 1;
+int cap_opterr = 1;
+int cap_optopt = '?';
+
+namespace {
+
+/* How non-option arguments are handled; see `initialize` */
+enum class Ordering { require_order, permute, return_in_order };
+
+/* State carried between calls */
+struct GetoptState {
+    bool initialized = false;
+    Ordering ordering = Ordering::permute;
+
+    /* The rest of the current short option cluster (e.g. "bc" after `-a` of `-abc`) */
+    const char *nextchar = nullptr;
+
+    /* The non-options skipped so far (when permuting) are `argv[first_nonopt, last_nonopt)` */
+    int first_nonopt = 1;
+    int last_nonopt = 1;
+};
+
+GetoptState state;
+
+/* `LongOptionIndex` is a lookup index over a `longopts` table: the names of all long options,
+sorted with the same index as the compact dispatch of `CommandLineOptions` (see src/nameindex.h),
+so that exact matches and abbreviations are found with a binary search rather than by scanning
+the whole table on every long option. */
+class LongOptionIndex {
+
+    std::vector<IndexedName> entries;
+
+    /* The table that was indexed, and the name of each of its options (in table order) */
+    const cap_option *table = nullptr;
+    std::vector<const char *> table_names;
+
+    /* Whether the index has been checked against `table` since parsing was (re-)initialized */
+    bool checked = false;
+
+    /* Whether the index is up to date with `longopts`. Besides checking that `longopts` is the
+    table that was indexed, we check that its names are unchanged, since tables are often
+    stack-allocated (so that the same address may hold a different table on a later parse). */
+    auto is_current(const cap_option *longopts) const -> bool {
+        if (longopts != table) {
+            return false;
+        }
+        for (std::size_t i = 0; i < table_names.size(); ++i) {
+            if (longopts[i].name != table_names[i]) {
+                return false;
+            }
+        }
+        return longopts[table_names.size()].name == nullptr;
+    }
+
+public:
+
+    /* Makes the next `update` check the whole table again. This is called whenever parsing is
+    (re-)initialized, so that the table is only compared name by name once per parse, rather than
+    on every long option. */
+    void invalidate() {
+        checked = false;
+    }
+
+    /* Rebuilds the index if it is not up to date with `longopts` */
+    void update(const cap_option *longopts) {
+        if (checked && longopts == table) {
+            return;
+        }
+        checked = true;
+        if (is_current(longopts)) {
+            return;
+        }
+        table = longopts;
+        table_names.clear();
+        entries.clear();
+        for (std::size_t i = 0; longopts[i].name; ++i) {
+            table_names.push_back(longopts[i].name);
+            entries.push_back({longopts[i].name, i});
+        }
+        sort_names(entries);
+    }
+
+    /* Returns the entries whose names begin with `prefix`. An exact match, if there is one, is
+    always first. */
+    auto find_prefix(std::string_view prefix) const -> std::span<const IndexedName> {
+        return ::find_prefix(entries, prefix);
+    }
+};
+
+LongOptionIndex long_option_index;
+
+/* Re-initializes the parser (on the first call, or when `cap_optind` is set to 0), returning
+`optstring` with any leading `-` or `+` removed. */
+auto initialize(const char *optstring) -> const char * {
+    if (cap_optind == 0) {
+        cap_optind = 1;
+    }
+    state.first_nonopt = state.last_nonopt = cap_optind;
+    state.nextchar = nullptr;
+    long_option_index.invalidate();
+
+    /* A leading `-` returns non-options in order as the argument of option 1, a leading `+` (or
+    setting `POSIXLY_CORRECT`) stops at the first non-option, and otherwise, non-options are
+    permuted to the end of `argv` */
+    if (optstring[0] == '-') {
+        state.ordering = Ordering::return_in_order;
+        ++optstring;
+    } else if (optstring[0] == '+') {
+        state.ordering = Ordering::require_order;
+        ++optstring;
+    } else if (std::getenv("POSIXLY_CORRECT")) {
+        state.ordering = Ordering::require_order;
+    } else {
+        state.ordering = Ordering::permute;
+    }
+
+    state.initialized = true;
+    return optstring;
+}
+
+/* Moves the skipped non-options `argv[first_nonopt, last_nonopt)` after the options processed
+since, `argv[last_nonopt, cap_optind)`, preserving the relative order of each */
+void exchange(char **argv) {
+    std::rotate(argv + state.first_nonopt, argv + state.last_nonopt, argv + cap_optind);
+    state.first_nonopt += cap_optind - state.last_nonopt;
+    state.last_nonopt = cap_optind;
+}
+
+/* Handles the long option `--name[=value]` whose name begins at `state.nextchar` */
+auto process_long_option(
+    int argc,
+    char **argv,
+    const char *optstring,
+    const cap_option *longopts,
+    int *longindex,
+    bool print_errors
+) -> int {
+    auto nameend = state.nextchar;
+    while (*nameend && *nameend != '=') {
+        ++nameend;
+    }
+    auto name = std::string_view(
+        state.nextchar, static_cast<std::size_t>(nameend - state.nextchar)
+    );
+
+    /* Look for an exact match first; failing that, for an unambiguous abbreviation. As in glibc,
+    an abbreviation matching several options is still unambiguous if all of those options are
+    equivalent, in which case the first of them in the table is used. */
+    auto matches = long_option_index.find_prefix(name);
+    int option_index = -1;
+    if (!matches.empty() && matches.front().name.size() == name.size()) {
+        option_index = static_cast<int>(matches.front().position);
+    } else if (!matches.empty()) {
+        option_index = static_cast<int>(std::min_element(
+            matches.begin(), matches.end(), [](auto &a, auto &b) { return a.position < b.position; }
+        )->position);
+        auto &candidate = longopts[option_index];
+        bool ambiguous = std::any_of(matches.begin(), matches.end(), [&](auto &entry) {
+            auto &other = longopts[entry.position];
+            return other.has_arg != candidate.has_arg || other.flag != candidate.flag ||
+                   other.val != candidate.val;
+        });
+        if (ambiguous) {
+            if (print_errors) {
+                std::vector<std::size_t> possibilities;
+                for (auto &entry : matches) {
+                    possibilities.push_back(entry.position);
+                }
+                std::sort(possibilities.begin(), possibilities.end());
+                auto message = std::format(
+                    "{}: option '--{}' is ambiguous; possibilities:", argv[0], state.nextchar
+                );
+                for (auto possibility : possibilities) {
+                    std::format_to(
+                        std::back_inserter(message), " '--{}'", longopts[possibility].name
+                    );
+                }
+                message += '\n';
+                write_stderr(message);
+            }
+            state.nextchar += std::strlen(state.nextchar);
+            ++cap_optind;
+            cap_optopt = 0;
+            return '?';
+        }
+    }
+
+    if (option_index == -1) {
+        if (print_errors) {
+            write_stderr(std::format("{}: unrecognized option '--{}'\n", argv[0], state.nextchar));
+        }
+        state.nextchar = nullptr;
+        ++cap_optind;
+        cap_optopt = 0;
+        return '?';
+    }
+    auto found = &longopts[option_index];
+
+    /* We have found a matching long option; consume it (and its value, if any) */
+    ++cap_optind;
+    state.nextchar = nullptr;
+    if (*nameend) {
+        if (found->has_arg) {
+            cap_optarg = const_cast<char *>(nameend + 1);
+        } else {
+            if (print_errors) {
+                write_stderr(std::format(
+                    "{}: option '--{}' doesn't allow an argument\n", argv[0], found->name
+                ));
+            }
+            cap_optopt = found->val;
+            return '?';
+        }
+    } else if (found->has_arg == CAP_REQUIRED_ARGUMENT) {
+        if (cap_optind < argc) {
+            cap_optarg = argv[cap_optind++];
+        } else {
+            if (print_errors) {
+                write_stderr(std::format(
+                    "{}: option '--{}' requires an argument\n", argv[0], found->name
+                ));
+            }
+            cap_optopt = found->val;
+            return optstring[0] == ':' ? ':' : '?';
+        }
+    }
+
+    if (longindex) {
+        *longindex = option_index;
+    }
+    if (found->flag) {
+        *found->flag = found->val;
+        return 0;
+    }
+    return found->val;
+}
+
+}
+
+extern "C" int cap_getopt_long(
+    int argc,
+    char *const argv_const[],
+    const char *optstring,
+    const cap_option *longopts,
+    int *longindex
+) {
+    /* Like `getopt_long`, we permute `argv` in place despite its `const`-qualified pointers */
+    auto argv = const_cast<char **>(argv_const);
+    if (argc < 1) {
+        return -1;
+    }
+
+    cap_optarg = nullptr;
+    bool print_errors = cap_opterr != 0;
+    if (cap_optind == 0 || !state.initialized) {
+        optstring = initialize(optstring);
+    } else if (optstring[0] == '-' || optstring[0] == '+') {
+        ++optstring;
+    }
+    if (optstring[0] == ':') {
+        print_errors = false;
+    }
+
+    /* Whether `argv[cap_optind]` is a non-option (an argument that does not begin with `-`, or
+    that is exactly `-`) */
+    auto is_nonoption = [&] {
+        return argv[cap_optind][0] != '-' || argv[cap_optind][1] == '\0';
+    };
+
+    if (!state.nextchar || *state.nextchar == '\0') {
+        /* Advance to the next argument. If the caller moved `cap_optind` backwards, clamp the
+        range of skipped non-options accordingly. */
+        state.last_nonopt = std::min(state.last_nonopt, cap_optind);
+        state.first_nonopt = std::min(state.first_nonopt, cap_optind);
+
+        if (state.ordering == Ordering::permute) {
+            /* Move any non-options skipped earlier after the options processed since, then skip
+            the non-options starting at `cap_optind` */
+            if (state.first_nonopt != state.last_nonopt && state.last_nonopt != cap_optind) {
+                exchange(argv);
+            } else if (state.last_nonopt != cap_optind) {
+                state.first_nonopt = cap_optind;
+            }
+            while (cap_optind < argc && is_nonoption()) {
+                ++cap_optind;
+            }
+            state.last_nonopt = cap_optind;
+        }
+
+        /* `--` ends option processing; everything after it is a non-option */
+        if (cap_optind != argc && std::strcmp(argv[cap_optind], "--") == 0) {
+            ++cap_optind;
+            if (state.first_nonopt != state.last_nonopt && state.last_nonopt != cap_optind) {
+                exchange(argv);
+            } else if (state.first_nonopt == state.last_nonopt) {
+                state.first_nonopt = cap_optind;
+            }
+            state.last_nonopt = argc;
+            cap_optind = argc;
+        }
+
+        /* At the end of `argv`, point `cap_optind` at the first (permuted) non-option */
+        if (cap_optind == argc) {
+            if (state.first_nonopt != state.last_nonopt) {
+                cap_optind = state.first_nonopt;
+            }
+            return -1;
+        }
+
+        if (is_nonoption()) {
+            if (state.ordering == Ordering::require_order) {
+                return -1;
+            }
+            cap_optarg = argv[cap_optind++];
+            return 1;
+        }
+
+        if (longopts && argv[cap_optind][1] == '-') {
+            long_option_index.update(longopts);
+            state.nextchar = argv[cap_optind] + 2;
+            return process_long_option(argc, argv, optstring, longopts, longindex, print_errors);
+        }
+
+        state.nextchar = argv[cap_optind] + 1;
+    }
+
+    /* Handle the next short option character of the current cluster */
+    char c = *state.nextchar++;
+    auto spec = std::strchr(optstring, c);
+
+    /* `cap_optind` is advanced as soon as we start processing the last character of a cluster */
+    if (*state.nextchar == '\0') {
+        ++cap_optind;
+    }
+
+    if (!spec || c == ':' || c == ';') {
+        if (print_errors) {
+            write_stderr(std::format("{}: invalid option -- '{}'\n", argv[0], c));
+        }
+        cap_optopt = c;
+        return '?';
+    }
+
+    if (spec[1] == ':') {
+        if (spec[2] == ':') {
+            /* An optional value must be attached (`-cvalue`) */
+            if (*state.nextchar != '\0') {
+                cap_optarg = const_cast<char *>(state.nextchar);
+                ++cap_optind;
+            } else {
+                cap_optarg = nullptr;
+            }
+        } else {
+            /* A required value is either attached (`-n5`) or the next argument (`-n 5`) */
+            if (*state.nextchar != '\0') {
+                cap_optarg = const_cast<char *>(state.nextchar);
+                ++cap_optind;
+            } else if (cap_optind == argc) {
+                if (print_errors) {
+                    write_stderr(std::format(
+                        "{}: option requires an argument -- '{}'\n", argv[0], c
+                    ));
+                }
+                cap_optopt = c;
+                c = optstring[0] == ':' ? ':' : '?';
+            } else {
+                cap_optarg = argv[cap_optind++];
+            }
+        }
+        state.nextchar = nullptr;
+    }
+
+    return c;
+}
@@ -1,11 +1,11 @@
 #include "argumentparser.h"
-#include <iostream>
+#include "output.h"
 
 int main(int argc, char** argv)
 {
     /* Read and print out command-line options */
     CommandLineOptions options(argc, argv);
-    std::cout << std::format("Parsed options: {}", options);
+    write_stdout(std::format("Parsed options: {}", options));
 
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,167 @@
+#include "mappedtext.h"
+#include <filesystem>
+
+#ifdef CPP_ARGUMENT_PARSER_IS_ON_WINDOWS
+#include "windows.h"
+#else
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+/* `FileMapping` is a read-only mapping of the whole file at a path, which is unmapped when it is
+destroyed. An empty file is not mapped at all (mapping zero bytes is an error), and its contents
+are empty. */
+class FileMapping {
+    const char *data = nullptr;
+    std::size_t size = 0;
+
+public:
+
+    /* Maps the file at `path`, or returns `nullptr` with the reason in `error` if it cannot be
+    mapped. `path` is encoded in UTF-8, like all command-line arguments. */
+    static auto map(
+        std::string_view path,
+        std::string &error
+    ) -> std::shared_ptr<const FileMapping>;
+
+    FileMapping(const char *data, std::size_t size) : data(data), size(size) {}
+    FileMapping(const FileMapping &) = delete;
+    auto operator=(const FileMapping &) -> FileMapping & = delete;
+    ~FileMapping();
+
+    auto contents() const -> std::string_view {
+        return std::string_view(data, size);
+    }
+};
+
+#ifdef CPP_ARGUMENT_PARSER_IS_ON_WINDOWS
+
+auto FileMapping::map(
+    std::string_view path,
+    std::string &error
+) -> std::shared_ptr<const FileMapping> {
+    /* Convert the path from UTF-8, as for path options */
+    auto file_path = std::filesystem::path(
+        std::u8string_view(reinterpret_cast<const char8_t *>(path.data()), path.size())
+    );
+    auto file = CreateFileW(
+        file_path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+        FILE_ATTRIBUTE_NORMAL, nullptr
+    );
+    if (file == INVALID_HANDLE_VALUE) {
+        error = std::format("error {}", GetLastError());
+        return nullptr;
+    }
+
+    LARGE_INTEGER file_size;
+    if (!GetFileSizeEx(file, &file_size)) {
+        error = std::format("error {}", GetLastError());
+        CloseHandle(file);
+        return nullptr;
+    }
+    if (file_size.QuadPart == 0) {
+        CloseHandle(file);
+        return std::make_shared<const FileMapping>(nullptr, 0);
+    }
+
+    /* The view keeps the file mapped after both handles are closed */
+    auto file_mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    const void *view = file_mapping ? MapViewOfFile(file_mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+    if (!view) {
+        error = std::format("error {}", GetLastError());
+    }
+    if (file_mapping) {
+        CloseHandle(file_mapping);
+    }
+    CloseHandle(file);
+    if (!view) {
+        return nullptr;
+    }
+    return std::make_shared<const FileMapping>(
+        static_cast<const char *>(view), static_cast<std::size_t>(file_size.QuadPart)
+    );
+}
+
+FileMapping::~FileMapping() {
+    if (data) {
+        UnmapViewOfFile(data);
+    }
+}
+
+#else
+
+auto FileMapping::map(
+    std::string_view path,
+    std::string &error
+) -> std::shared_ptr<const FileMapping> {
+    int fd = ::open(std::string(path).c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        error = std::strerror(errno);
+        return nullptr;
+    }
+
+    struct stat file_status;
+    if (::fstat(fd, &file_status) < 0) {
+        error = std::strerror(errno);
+        ::close(fd);
+        return nullptr;
+    }
+    if (!S_ISREG(file_status.st_mode)) {
+        error = "not a regular file";
+        ::close(fd);
+        return nullptr;
+    }
+    if (file_status.st_size == 0) {
+        ::close(fd);
+        return std::make_shared<const FileMapping>(nullptr, 0);
+    }
+
+    /* The mapping stays valid after the file is closed */
+    auto size = static_cast<std::size_t>(file_status.st_size);
+    auto data = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (data == MAP_FAILED) {
+        error = std::strerror(errno);
+        ::close(fd);
+        return nullptr;
+    }
+    ::close(fd);
+    return std::make_shared<const FileMapping>(static_cast<const char *>(data), size);
+}
+
+FileMapping::~FileMapping() {
+    if (data) {
+        ::munmap(const_cast<char *>(data), size);
+    }
+}
+
+#endif
+
+auto MappedText::assign(std::string_view argument, std::string &error) -> bool {
+    if (argument.starts_with('@') && !argument.starts_with("@@")) {
+#ifdef CPP_ARGUMENT_PARSER_FUZZING
+        /* The fuzz target must not read whatever files its inputs name (such as `@/dev/zero`), so
+        there, the file is not mapped, and the value is empty */
+        mapping.reset();
+        text.clear();
+#else
+        auto file_mapping = FileMapping::map(argument.substr(1), error);
+        if (!file_mapping) {
+            return false;
+        }
+        mapping = std::move(file_mapping);
+        text.clear();
+#endif
+    } else {
+        mapping.reset();
+        text = argument.starts_with('@') ? argument.substr(1) : argument;
+    }
+    return true;
+}
+
+auto MappedText::view() const -> std::string_view {
+    return mapping ? mapping->contents() : std::string_view(text);
+}
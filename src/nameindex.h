@@ -0,0 +1,122 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <span>
+#include <string_view>
+
+/* The lookup of option names in a table of names, shared by the compact dispatch of
+`CommandLineOptions` (whose table is built at compile time) and `cap_getopt_long` (whose table is
+given at run time, see src/getopt_compat.cpp). A table is indexed by sorting its names, so that a
+name, or every name that begins with a prefix, is found with a binary search. */
+
+/* A name in an index, together with the position in its table of the option it names */
+struct IndexedName {
+    std::string_view name;
+    std::size_t position;
+
+    /* Names are sorted by their bytes, and equal names by their positions in the table */
+    constexpr auto operator<(const IndexedName &other) const -> bool {
+        return name < other.name || (name == other.name && position < other.position);
+    }
+};
+
+/* Sorts the names `names` of a table into an index */
+constexpr void sort_names(std::span<IndexedName> names) {
+    std::sort(names.begin(), names.end());
+}
+
+/* Returns the names in the index `names` that begin with `prefix`, in sorted order (so that the
+name equal to `prefix`, if there is one, is first) */
+constexpr auto find_prefix(
+    std::span<const IndexedName> names,
+    std::string_view prefix
+) -> std::span<const IndexedName> {
+    auto first = std::lower_bound(
+        names.begin(), names.end(), prefix,
+        [](const IndexedName &entry, std::string_view prefix) { return entry.name < prefix; }
+    );
+    /* The names that begin with `prefix` are the ones from `first` up to the first name that
+    does not, since `prefix` sorts before all of them */
+    auto last = std::partition_point(first, names.end(), [&](const IndexedName &entry) {
+        return entry.name.starts_with(prefix);
+    });
+    return std::span<const IndexedName>(first, last);
+}
+
+/* Returns the name in the index `names` that is equal to `name` (the first in the table, if
+several are), or `nullptr` if there is none */
+constexpr auto find_name(
+    std::span<const IndexedName> names,
+    std::string_view name
+) -> const IndexedName * {
+    auto found = std::lower_bound(
+        names.begin(), names.end(), name,
+        [](const IndexedName &entry, std::string_view name) { return entry.name < name; }
+    );
+    if (found == names.end() || found->name != name) {
+        return nullptr;
+    }
+    return &*found;
+}
+
+/* In loose name mode (`CPP_ARGUMENT_PARSER_LOOSE_NAMES`), `CommandLineOptions` compares option
+names by their keys (see `fold_option_name`) rather than exactly. The keys of the names in its
+table are computed at compile time by `OptionKeys`, which also rejects two names with the same key
+(tests/loose_name_collision.cpp checks that this is a compile error). */
+
+/* Writes the key of the option name `name` to `key` (which must have room for `name.size()`
+characters), and returns its size. The key is `name` with ASCII letters converted to lowercase,
+and with every `-` and `_` removed, so that e.g. `imageFile`, `image-file`, and `image_file` all
+have the key `imagefile`. This is a single pass without branches on the characters of `name`:
+every character is written, but the end of the key only advances past characters that are kept.
+It is used both at compile time (for the option names in `CommandLineOptions::try_processing`)
+and at run time (for the option names given on the command line). */
+constexpr auto fold_option_name(std::string_view name, char *key) -> std::size_t {
+    std::size_t key_size = 0;
+    for (char c : name) {
+        auto is_upper = static_cast<unsigned char>(c - 'A') < 26;
+        key[key_size] = static_cast<char>(c + is_upper * ('a' - 'A'));
+        key_size += c != '-' && c != '_';
+    }
+    return key_size;
+}
+
+/* Called (at compile time) if two option names have the same key, which makes the program
+ill-formed, because this function is not `constexpr`. */
+inline void duplicate_option_key(std::string_view) {}
+
+/* `OptionKeys<Size, NumNames>` stores the keys of `NumNames` option names (with `Size`
+characters in total, at most) back to back, so that they can be computed once, at compile time. */
+template <std::size_t Size, std::size_t NumNames>
+struct OptionKeys {
+    std::array<char, Size> characters{};
+    std::array<std::size_t, NumNames + 1> offsets{};
+
+    /* The size of the longest key */
+    std::size_t max_size = 0;
+
+    /* Computes the keys of `names...` */
+    constexpr OptionKeys(auto... names) {
+        std::size_t index = 0;
+        ((offsets[index + 1] = offsets[index] + fold_option_name(
+            names.name, characters.data() + offsets[index]
+        ), ++index), ...);
+        for (std::size_t i = 0; i < NumNames; ++i) {
+            max_size = std::max(max_size, (*this)[i].size());
+            for (std::size_t j = 0; j < i; ++j) {
+                if ((*this)[i] == (*this)[j]) {
+                    duplicate_option_key((*this)[i]);
+                }
+            }
+        }
+    }
+
+    /* Returns the key of the option name at `index` */
+    constexpr auto operator[](std::size_t index) const -> std::string_view {
+        return std::string_view(
+            characters.data() + offsets[index], offsets[index + 1] - offsets[index]
+        );
+    }
+};
@@ -0,0 +1,174 @@
+#include "optionsoverlay.h"
+
+namespace {
+
+/* The operations on the value of an overridden field that do not depend on which field it is */
+struct FieldOperations {
+    void (*copy)(void *to, const void *from);
+    void (*relocate)(void *to, void *from) noexcept;
+    void (*destroy)(void *value) noexcept;
+    void (*apply)(CommandLineOptions &options, const void *value);
+};
+
+template <typename T>
+void copy_field(void *to, const void *from) {
+    ::new (to) T(*std::launder(static_cast<const T *>(from)));
+}
+
+/* Moves the value at `from` to `to`, and destroys the value at `from` */
+template <typename T>
+void relocate_field(void *to, void *from) noexcept {
+    auto value = std::launder(static_cast<T *>(from));
+    ::new (to) T(std::move(*value));
+    value->~T();
+}
+
+template <typename T>
+void destroy_field(void *value) noexcept {
+    std::launder(static_cast<T *>(value))->~T();
+}
+
+/* Sets the field `Member` of `options` to the value at `value` */
+template <auto Member>
+void apply_field(CommandLineOptions &options, const void *value) {
+    using T = typename OptionField<Member>::type;
+    options.*Member = *std::launder(static_cast<const T *>(value));
+}
+
+/* The operations of every field, in the order of `with_option_fields` */
+constexpr auto field_operations = with_option_fields([](auto... fields) {
+    return std::array{FieldOperations{
+        &copy_field<typename decltype(fields)::type>,
+        &relocate_field<typename decltype(fields)::type>,
+        &destroy_field<typename decltype(fields)::type>,
+        &apply_field<decltype(fields)::member>
+    }...};
+});
+
+/* Calls `visit(field, slot)` for every overridden field (in order) in the presence mask
+`presence`, with the index `slot` of its slot */
+template <typename Presence>
+void for_each_override(const Presence &presence, auto visit) {
+    std::size_t slot = 0;
+    for (std::size_t word = 0; word < presence.size(); ++word) {
+        for (auto bits = presence[word]; bits != 0; bits &= bits - 1) {
+            visit(word * 64 + static_cast<std::size_t>(std::countr_zero(bits)), slot++);
+        }
+    }
+}
+
+}
+
+/* The slots are laid out in field order after their offsets, each at the next offset aligned for
+the type of its field */
+auto OptionsOverlay::allocate_slots(const PresenceMask &mask) -> std::unique_ptr<Block[]> {
+    std::size_t num_slots = 0;
+    for (auto word : mask) {
+        num_slots += static_cast<std::size_t>(std::popcount(word));
+    }
+    auto layout = [&](auto place) {
+        auto size = num_slots * sizeof(std::uint32_t);
+        for_each_override(mask, [&](std::size_t field, std::size_t slot) {
+            auto alignment = overlay_detail::field_alignments[field];
+            size = (size + alignment - 1) / alignment * alignment;
+            place(slot, size);
+            size += overlay_detail::field_sizes[field];
+        });
+        return size;
+    };
+
+    auto size = layout([](std::size_t, std::size_t) {});
+    auto num_blocks = (size + sizeof(Block) - 1) / sizeof(Block);
+    auto slots = std::make_unique_for_overwrite<Block[]>(num_blocks);
+    layout([&](std::size_t slot, std::size_t offset) {
+        auto offset_to_store = static_cast<std::uint32_t>(offset);
+        std::memcpy(
+            reinterpret_cast<std::byte *>(slots.get()) + slot * sizeof(offset_to_store),
+            &offset_to_store,
+            sizeof(offset_to_store)
+        );
+    });
+    return slots;
+}
+
+OptionsOverlay::OptionsOverlay(const OptionsOverlay &other) : base(other.base) {
+    if (other.num_overrides() == 0) {
+        return;
+    }
+    storage = allocate_slots(other.presence);
+    try {
+        for_each_override(other.presence, [&](std::size_t field, std::size_t slot) {
+            field_operations[field].copy(
+                slot_address(storage.get(), slot), slot_address(other.storage.get(), slot)
+            );
+
+            /* Set the bit of each field once its value has been copied, so that `destroy_slots`
+            only destroys the values copied so far */
+            presence[field / 64] |= std::uint64_t(1) << (field % 64);
+        });
+    } catch (...) {
+        /* The destructor does not run if the constructor throws */
+        destroy_slots();
+        throw;
+    }
+}
+
+OptionsOverlay::OptionsOverlay(OptionsOverlay &&other) noexcept
+    : base(other.base),
+      presence(std::exchange(other.presence, {})),
+      storage(std::move(other.storage)) {}
+
+auto OptionsOverlay::operator=(const OptionsOverlay &other) -> OptionsOverlay & {
+    if (this != &other) {
+        *this = OptionsOverlay(other);
+    }
+    return *this;
+}
+
+auto OptionsOverlay::operator=(OptionsOverlay &&other) noexcept -> OptionsOverlay & {
+    if (this != &other) {
+        destroy_slots();
+        base = other.base;
+        presence = std::exchange(other.presence, {});
+        storage = std::move(other.storage);
+    }
+    return *this;
+}
+
+OptionsOverlay::~OptionsOverlay() {
+    destroy_slots();
+}
+
+void OptionsOverlay::destroy_slots() noexcept {
+    for_each_override(presence, [&](std::size_t field, std::size_t slot) {
+        field_operations[field].destroy(slot_address(storage.get(), slot));
+    });
+    presence = {};
+}
+
+/* The storage holds exactly the slots of the overrides, so adding an override allocates new
+storage, and moves every other override into it. Overrides are expected to be set a few at a time,
+when an overlay is created, and then read many times. */
+auto OptionsOverlay::insert_slot(std::size_t field) -> void * {
+    auto new_presence = presence;
+    new_presence[field / 64] |= std::uint64_t(1) << (field % 64);
+    auto new_storage = allocate_slots(new_presence);
+    auto new_slot = rank(field);
+    for_each_override(presence, [&](std::size_t other_field, std::size_t slot) {
+        field_operations[other_field].relocate(
+            slot_address(new_storage.get(), slot < new_slot ? slot : slot + 1),
+            slot_address(storage.get(), slot)
+        );
+    });
+    storage = std::move(new_storage);
+    presence = new_presence;
+    return slot_address(storage.get(), new_slot);
+}
+
+auto OptionsOverlay::flatten() const -> CommandLineOptions {
+    auto options = *base;
+    for_each_override(presence, [&](std::size_t field, std::size_t slot) {
+        field_operations[field].apply(options, slot_address(storage.get(), slot));
+    });
+    return options;
+}
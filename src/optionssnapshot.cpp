@@ -0,0 +1,67 @@
+#include "optionssnapshot.h"
+#include "processoptions.h"
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+namespace {
+
+/* The most recently published snapshot, or `nullptr` before the first one is published */
+std::atomic<const OptionsSnapshot *> published_snapshot = nullptr;
+
+/* The snapshots that have been replaced, but not yet destroyed (see `reclaim_retired_snapshots`).
+They are destroyed at exit, if they have not been before. This is constant-initialized, so that
+options can be published during static initialization. */
+struct RetiredSnapshots {
+    std::mutex mutex;
+    std::vector<const OptionsSnapshot *> snapshots;
+
+    ~RetiredSnapshots() {
+        for (auto snapshot : snapshots) {
+            delete snapshot;
+        }
+    }
+};
+constinit RetiredSnapshots retired_snapshots;
+
+}
+
+void publish_options(const CommandLineOptions &options) {
+    auto replaced = published_snapshot.exchange(
+        new OptionsSnapshot(options), std::memory_order_acq_rel
+    );
+    if (replaced) {
+        std::lock_guard lock(retired_snapshots.mutex);
+        retired_snapshots.snapshots.push_back(replaced);
+    }
+}
+
+auto reclaim_retired_snapshots() -> std::size_t {
+    std::vector<const OptionsSnapshot *> snapshots;
+    {
+        std::lock_guard lock(retired_snapshots.mutex);
+        snapshots.swap(retired_snapshots.snapshots);
+    }
+    for (auto snapshot : snapshots) {
+        delete snapshot;
+    }
+    return snapshots.size();
+}
+
+auto current_options() -> const OptionsSnapshot & {
+    if (auto snapshot = published_snapshot.load(std::memory_order_acquire)) {
+        return *snapshot;
+    }
+
+    /* Publish the options of the process, unless another thread published a snapshot first (in
+    which case we use that one instead), as in `process_command_line_options` */
+    auto snapshot = new OptionsSnapshot(process_command_line_options());
+    const OptionsSnapshot *expected = nullptr;
+    if (!published_snapshot.compare_exchange_strong(
+        expected, snapshot, std::memory_order_acq_rel, std::memory_order_acquire
+    )) {
+        delete snapshot;
+        return *expected;
+    }
+    return *snapshot;
+}
@@ -0,0 +1,138 @@
+#include "output.h"
+
+#ifndef CPP_ARGUMENT_PARSER_NO_IOSTREAM
+
+#include <iostream>
+
+namespace {
+
+/* The standard streams are only guaranteed to be initialized once a `std::ios_base::Init` object
+has been constructed, which (with most standard libraries) happens during the static
+initialization of the translation units that include `<iostream>`. Output may be written before
+that, when options are parsed during static initialization (see include/processoptions.h), so we
+construct one ourselves on first use. */
+void ensure_streams_initialized() {
+    static const std::ios_base::Init streams_initializer;
+}
+
+}
+
+void write_stdout(std::string_view text) {
+    ensure_streams_initialized();
+    std::cout << text;
+}
+
+void write_stderr(std::string_view text) {
+    ensure_streams_initialized();
+    std::cerr << text;
+}
+
+void flush_output() {
+    ensure_streams_initialized();
+    std::cout.flush();
+    std::cerr.flush();
+}
+
+#else
+
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+
+#ifdef CPP_ARGUMENT_PARSER_IS_ON_WINDOWS
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace {
+
+/* Writes all of `data` to the file descriptor `fd`, retrying on partial writes and on interruption
+by signals. Output errors are ignored, as `std::cout` would by default. */
+void write_all(int fd, const char *data, std::size_t count) {
+    while (count > 0) {
+#ifdef CPP_ARGUMENT_PARSER_IS_ON_WINDOWS
+        auto written = _write(fd, data, static_cast<unsigned int>(count));
+#else
+        auto written = ::write(fd, data, count);
+#endif
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return;
+        }
+        data += written;
+        count -= static_cast<std::size_t>(written);
+    }
+}
+
+/* `FdWriter` buffers text written to it, and writes that text to the file descriptor `fd`
+whenever the buffer fills up or `flush()` is called. Its constructor is `constexpr`, so that
+the writer below is constant-initialized and needs no static initialization. An `FdWriter` is not
+thread-safe; `stdout_mutex` serializes the use of `stdout_writer`. */
+class FdWriter {
+    int fd;
+    std::size_t size = 0;
+    char buffer[4096];
+
+public:
+
+    constexpr explicit FdWriter(int fd) : fd(fd), buffer() {}
+
+    void write(std::string_view text) {
+        /* Text that does not fit in the remaining buffer space is written directly (after
+        flushing what was already buffered), rather than being split across buffers */
+        if (text.size() > sizeof(buffer) - size) {
+            flush();
+            if (text.size() >= sizeof(buffer)) {
+                write_all(fd, text.data(), text.size());
+                return;
+            }
+        }
+        std::memcpy(buffer + size, text.data(), text.size());
+        size += text.size();
+    }
+
+    void flush() {
+        write_all(fd, buffer, size);
+        size = 0;
+    }
+};
+
+/* Only `stdout` is buffered. Like `std::cerr`, `stderr` is unbuffered, so that diagnostics written
+just before a crash or an `abort` are not lost. */
+constinit std::mutex stdout_mutex;
+constinit FdWriter stdout_writer(1);
+
+/* Registers `flush_output` to be called at exit, the first time anything is written */
+void flush_at_exit() {
+    static bool registered = (std::atexit(flush_output), true);
+    (void)registered;
+}
+
+}
+
+void write_stdout(std::string_view text) {
+    flush_at_exit();
+    std::lock_guard lock(stdout_mutex);
+    stdout_writer.write(text);
+}
+
+void write_stderr(std::string_view text) {
+    /* What was written to `stdout` before is written first, as `std::cerr` (which is tied to
+    `std::cout`) would, so that the two stay in order when they go to the same terminal or file */
+    {
+        std::lock_guard lock(stdout_mutex);
+        stdout_writer.flush();
+    }
+    write_all(2, text.data(), text.size());
+}
+
+void flush_output() {
+    std::lock_guard lock(stdout_mutex);
+    stdout_writer.flush();
+}
+
+#endif
@@ -0,0 +1,39 @@
+#include "parseprofile.h"
+#include <format>
+#include <iterator>
+
+/* This file is only compiled into instrumented builds (see the
+`CPP_ARGUMENT_PARSER_INSTRUMENTATION` option in CMakeLists.txt). */
+
+namespace {
+
+/* The names of each `ParsePhase`, used as key prefixes in `ParseProfile::report()` */
+constexpr const char *phase_names[] = {
+    "get_arguments", "tokenize", "dispatch", "validate", "convert"
+};
+static_assert(std::size(phase_names) == static_cast<std::size_t>(ParsePhase::num_phases));
+
+}
+
+auto ParseProfile::report() -> std::string {
+    /* Charge the time since the last phase switch before reporting */
+    switch_to(current_phase);
+
+    std::string line = "parse_profile:";
+    PhaseTotals all;
+    for (std::size_t i = 0; i < totals.size(); ++i) {
+        std::format_to(
+            std::back_inserter(line), " {0}_ns={1} {0}_allocs={2} {0}_bytes={3}",
+            phase_names[i], totals[i].nanoseconds, totals[i].allocations, totals[i].allocated_bytes
+        );
+        all.nanoseconds += totals[i].nanoseconds;
+        all.allocations += totals[i].allocations;
+        all.allocated_bytes += totals[i].allocated_bytes;
+    }
+    std::format_to(
+        std::back_inserter(line), " total_ns={} total_allocs={} total_bytes={}",
+        all.nanoseconds, all.allocations, all.allocated_bytes
+    );
+
+    return line;
+}
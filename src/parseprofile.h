@@ -0,0 +1,125 @@
+#pragma once
+
+#ifdef CPP_ARGUMENT_PARSER_INSTRUMENTATION
+
+#include "parsestats.h"
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <utility>
+
+/* The phases of parsing that `ParseProfile` attributes time and allocations to. Every moment
+of a parse belongs to exactly one phase; `tokenize` is the phase of the argument loop in the
+`CommandLineOptions` constructor itself, and the other phases are entered from within it. */
+enum class ParsePhase : std::size_t {
+    get_arguments,  /* `get_command_line_arguments` */
+    tokenize,       /* Splitting arguments into dashes, option names, and values */
+    dispatch,       /* Matching option names in `try_processing` */
+    validate,       /* Checks in `try_set_option` (boolean clusters, missing values) */
+    convert,        /* String-to-`T` conversion in `try_assign` */
+    num_phases
+};
+
+/* `ParseProfile` records, for each `ParsePhase`, the number of nanoseconds spent in that phase,
+as well as the number of allocations made (and bytes allocated) during that phase. Allocations
+are those of the storage owned by the parser, as counted by its `ParseStatsTracker` (instrumented
+builds always count them; see CMakeLists.txt), so the global `operator new` is left alone. Time is
+attributed exclusively: entering a nested phase (e.g. `convert` from within `dispatch`) pauses
+the enclosing phase until the nested phase is exited. Constructing a `ParseProfile` makes it
+the active profile of the current thread, which is the one that `ParsePhaseScope`s report to. */
+class ParseProfile {
+
+    struct PhaseTotals {
+        std::uint64_t nanoseconds = 0;
+        std::uint64_t allocations = 0;
+        std::uint64_t allocated_bytes = 0;
+    };
+
+    std::array<PhaseTotals, static_cast<std::size_t>(ParsePhase::num_phases)> totals{};
+
+    /* The tracker of the parser being profiled, which counts its allocations */
+    const ParseStatsTracker &tracker;
+
+    /* The phase currently being timed, and the clock and allocation counters as of the moment
+    that phase was (re-)entered */
+    ParsePhase current_phase = ParsePhase::tokenize;
+    std::chrono::steady_clock::time_point phase_start = std::chrono::steady_clock::now();
+    std::uint64_t allocations_at_phase_start = tracker.get().allocations;
+    std::uint64_t bytes_at_phase_start = tracker.get().bytes;
+
+    /* The profile that was active on this thread before this one was constructed */
+    ParseProfile *previous_active_profile;
+
+    static inline thread_local ParseProfile *active_profile = nullptr;
+
+    friend class ParsePhaseScope;
+
+    /* Charges everything since the last phase switch to `current_phase`, then makes `next` the
+    current phase. Returns the phase that was current before the switch. */
+    auto switch_to(ParsePhase next) -> ParsePhase {
+        auto now = std::chrono::steady_clock::now();
+        std::uint64_t allocations_now = tracker.get().allocations;
+        std::uint64_t bytes_now = tracker.get().bytes;
+
+        auto &totals_for_phase = totals[static_cast<std::size_t>(current_phase)];
+        totals_for_phase.nanoseconds += static_cast<std::uint64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(now - phase_start).count()
+        );
+        totals_for_phase.allocations += allocations_now - allocations_at_phase_start;
+        totals_for_phase.allocated_bytes += bytes_now - bytes_at_phase_start;
+
+        phase_start = now;
+        allocations_at_phase_start = allocations_now;
+        bytes_at_phase_start = bytes_now;
+        return std::exchange(current_phase, next);
+    }
+
+public:
+
+    /* Constructs a profile of the parser whose allocations are counted by `tracker` */
+    explicit ParseProfile(const ParseStatsTracker &tracker)
+        : tracker(tracker), previous_active_profile(std::exchange(active_profile, this)) {}
+    ~ParseProfile() { active_profile = previous_active_profile; }
+
+    ParseProfile(const ParseProfile &) = delete;
+    auto operator=(const ParseProfile &) -> ParseProfile & = delete;
+
+    /* Returns a single line of space-separated `key=value` pairs giving the nanoseconds,
+    allocations, and allocated bytes of every phase, followed by their totals. */
+    auto report() -> std::string;
+};
+
+/* While a `ParsePhaseScope` is alive, time and allocations on the current thread are charged
+to its phase in the active `ParseProfile` (if there is one). */
+class ParsePhaseScope {
+    ParseProfile *profile;
+    ParsePhase enclosing_phase{};
+
+public:
+
+    explicit ParsePhaseScope(ParsePhase phase) : profile(ParseProfile::active_profile) {
+        if (profile) {
+            enclosing_phase = profile->switch_to(phase);
+        }
+    }
+    ~ParsePhaseScope() {
+        if (profile) {
+            profile->switch_to(enclosing_phase);
+        }
+    }
+
+    ParsePhaseScope(const ParsePhaseScope &) = delete;
+    auto operator=(const ParsePhaseScope &) -> ParsePhaseScope & = delete;
+};
+
+/* Charges the rest of the enclosing block to the parse phase `phase` */
+#define CPP_ARGUMENT_PARSER_PROFILE_PHASE(phase) \
+    ParsePhaseScope parse_phase_scope_(ParsePhase::phase)
+
+#else
+
+/* Instrumentation is disabled, so profiling phases compiles to nothing. */
+#define CPP_ARGUMENT_PARSER_PROFILE_PHASE(phase)
+
+#endif
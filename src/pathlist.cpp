@@ -0,0 +1,589 @@
+#include "pathlist.h"
+#include <algorithm>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#ifdef __linux__
+#include <cerrno>
+#include <cstring>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+struct PathArena {
+    std::string text;
+    std::vector<std::size_t> offsets;
+};
+
+namespace {
+
+/* The separator between the entries of a path list */
+#ifdef CPP_ARGUMENT_PARSER_IS_ON_WINDOWS
+constexpr char path_list_separator = ';';
+#else
+constexpr char path_list_separator = ':';
+#endif
+
+/* The most components a glob pattern may have after its first component with a wildcard (the
+states of a traversal are bits of a 64-bit mask; see `GlobMatcher`) */
+constexpr std::size_t max_pattern_components = 63;
+
+/* Returns whether the pattern component `component` contains a wildcard */
+auto has_wildcard(std::string_view component) -> bool {
+    return component.find_first_of("*?[") != std::string_view::npos;
+}
+
+/* Returns whether the pattern component `component` has a character class (`[...]`) without the
+`]` that ends it, where a `]` right after the `[` (or after `[!` or `[^`) is one of the characters
+of the class, as in `matches_component` */
+auto has_unterminated_class(std::string_view component) -> bool {
+    for (auto p = component.find('['); p != std::string_view::npos; p = component.find('[', p)) {
+        auto q = p + 1;
+        q += q < component.size() && (component[q] == '!' || component[q] == '^');
+        auto first = q;
+        while (q < component.size() && (component[q] != ']' || q == first)) {
+            ++q;
+        }
+        if (q == component.size()) {
+            return true;
+        }
+        p = q + 1;
+    }
+    return false;
+}
+
+/* Returns whether the name `name` matches the pattern component `pattern` (which contains no
+`/`). A name starting with `.` only matches a pattern starting with `.`. */
+auto matches_component(std::string_view pattern, std::string_view name) -> bool {
+    if (name.starts_with('.') && !pattern.starts_with('.')) {
+        return false;
+    }
+
+    /* Match with backtracking to the last `*` only, which is enough for patterns without `/` */
+    std::size_t p = 0, n = 0;
+    std::size_t star_p = std::string_view::npos, star_n = 0;
+    while (n < name.size()) {
+        if (p < pattern.size() && pattern[p] == '*') {
+            star_p = p++;
+            star_n = n;
+            continue;
+        }
+        if (p < pattern.size() && pattern[p] == '[') {
+            /* A character class: find its end, and whether `name[n]` is in it */
+            auto q = p + 1;
+            bool negated = q < pattern.size() && (pattern[q] == '!' || pattern[q] == '^');
+            q += negated;
+            bool found = false;
+            auto first = q;
+            while (q < pattern.size() && (pattern[q] != ']' || q == first)) {
+                if (q + 2 < pattern.size() && pattern[q + 1] == '-' && pattern[q + 2] != ']') {
+                    found |= pattern[q] <= name[n] && name[n] <= pattern[q + 2];
+                    q += 3;
+                } else {
+                    found |= pattern[q] == name[n];
+                    ++q;
+                }
+            }
+            if (q < pattern.size() && found != negated) {
+                p = q + 1;
+                ++n;
+                continue;
+            }
+        } else if (p < pattern.size() && (pattern[p] == '?' || pattern[p] == name[n])) {
+            ++p;
+            ++n;
+            continue;
+        }
+        if (star_p == std::string_view::npos) {
+            return false;
+        }
+        p = star_p + 1;
+        n = ++star_n;
+    }
+    while (p < pattern.size() && pattern[p] == '*') {
+        ++p;
+    }
+    return p == pattern.size();
+}
+
+/* Matches the names of the entries in a traversal against the pattern components `components`
+(the components after the first one with a wildcard). The state of a directory in the traversal is
+a mask in which bit `i` is set if the path of the directory may have matched the first `i`
+components; bit `components.size()` means that all components were matched, so that every file
+below the directory matches. */
+struct GlobMatcher {
+    std::vector<std::string_view> components;
+
+    auto complete_bit() const -> std::uint64_t {
+        return std::uint64_t(1) << components.size();
+    }
+
+    /* Adds the states reached by matching `**` components with no directories */
+    auto closure(std::uint64_t mask) const -> std::uint64_t {
+        for (std::size_t i = 0; i < components.size(); ++i) {
+            if ((mask >> i) & 1 && components[i] == "**") {
+                mask |= std::uint64_t(1) << (i + 1);
+            }
+        }
+        return mask;
+    }
+
+    /* Returns the state of the entry named `name` in a directory in the state `mask` */
+    auto next(std::uint64_t mask, std::string_view name, bool is_directory) const -> std::uint64_t {
+        bool hidden = name.starts_with('.');
+        std::uint64_t next_mask = 0;
+        if ((mask & complete_bit()) && !hidden) {
+            next_mask |= complete_bit();
+        }
+        for (std::size_t i = 0; i < components.size(); ++i) {
+            if (!((mask >> i) & 1)) {
+                continue;
+            }
+            if (components[i] == "**") {
+                if (is_directory && !hidden) {
+                    next_mask |= std::uint64_t(1) << i;
+                }
+            } else if (matches_component(components[i], name)) {
+                next_mask |= std::uint64_t(1) << (i + 1);
+            }
+        }
+        return closure(next_mask);
+    }
+};
+
+/* The paths found by one thread of a traversal, stored one after another in `text` */
+struct FoundPaths {
+    std::string text;
+    std::vector<std::pair<std::size_t, std::size_t>> paths;  /* offsets and sizes in `text` */
+
+    void add(std::string_view directory, std::string_view name) {
+        auto offset = text.size();
+        text.append(directory);
+        if (!directory.empty() && !directory.ends_with('/')) {
+            text.push_back('/');
+        }
+        text.append(name);
+        paths.emplace_back(offset, text.size() - offset);
+    }
+};
+
+/* A directory to list in a traversal, with its state (see `GlobMatcher`) */
+struct Directory {
+    std::string path;
+    std::uint64_t mask;
+};
+
+/* Returns the name of the directory at `path` for messages: `.` for the current directory (whose
+path is empty), and otherwise `path` without a trailing `/` */
+auto directory_name(std::string_view path) -> std::string_view {
+    if (path.size() > 1 && path.ends_with('/')) {
+        path.remove_suffix(1);
+    }
+    return path.empty() ? "." : path;
+}
+
+/* The result of listing a directory with `list_directory` */
+enum class ListResult {
+    listed,
+    cannot_open,  /* the directory could not be opened (e.g. for lack of permission) */
+    cannot_read,  /* the directory was opened, but reading its entries failed part of the way */
+};
+
+/* Lists the entries of the directory at `path` (the current directory if it is empty), calling
+`visit(name, is_directory, is_file)` for each of them. If the directory cannot be opened or read,
+the reason is in `error`. */
+template <typename Visit>
+auto list_directory(const std::string &path, std::string &error, Visit visit) -> ListResult {
+#ifdef __linux__
+    int fd = ::openat(
+        AT_FDCWD, path.empty() ? "." : path.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC
+    );
+    if (fd < 0) {
+        error = std::strerror(errno);
+        return ListResult::cannot_open;
+    }
+
+    /* The header of each entry returned by `getdents64`, which is followed by its name */
+    struct EntryHeader {
+        std::uint64_t inode;
+        std::int64_t offset;
+        unsigned short size;
+        unsigned char type;
+    };
+    alignas(EntryHeader) char buffer[32768];
+    while (true) {
+        auto count = ::syscall(SYS_getdents64, fd, buffer, sizeof(buffer));
+        if (count < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            error = std::strerror(errno);
+            ::close(fd);
+            return ListResult::cannot_read;
+        } else if (count == 0) {
+            break;
+        }
+        for (long position = 0; position < count;) {
+            auto header = reinterpret_cast<const EntryHeader *>(buffer + position);
+            auto name = std::string_view(buffer + position + offsetof(EntryHeader, type) + 1);
+            position += header->size;
+            if (name == "." || name == "..") {
+                continue;
+            }
+
+            /* Find the types of entries whose types are not known (or that are symbolic links,
+            which are followed to files, but not to directories) */
+            auto type = header->type;
+            if (type == DT_UNKNOWN || type == DT_LNK) {
+                struct stat status;
+                if (::fstatat(fd, name.data(), &status, 0) < 0) {
+                    continue;
+                }
+                type = S_ISREG(status.st_mode) ? DT_REG :
+                    (S_ISDIR(status.st_mode) && header->type == DT_UNKNOWN) ? DT_DIR : DT_UNKNOWN;
+            }
+            visit(name, type == DT_DIR, type == DT_REG);
+        }
+    }
+    ::close(fd);
+    return ListResult::listed;
+#else
+    std::error_code error_code;
+    std::filesystem::directory_iterator entries(
+        path.empty() ? std::filesystem::path(".") : std::filesystem::path(path), error_code
+    );
+    if (error_code) {
+        error = error_code.message();
+        return ListResult::cannot_open;
+    }
+    for (; entries != std::filesystem::directory_iterator(); entries.increment(error_code)) {
+        if (error_code) {
+            error = error_code.message();
+            return ListResult::cannot_read;
+        }
+        const auto &entry = *entries;
+        auto name = entry.path().filename().string();
+        std::error_code type_error_code;
+        bool is_symlink = entry.is_symlink(type_error_code);
+        visit(
+            std::string_view(name), !is_symlink && entry.is_directory(type_error_code),
+            entry.is_regular_file(type_error_code)
+        );
+    }
+    if (error_code) {
+        error = error_code.message();
+        return ListResult::cannot_read;
+    }
+    return ListResult::listed;
+#endif
+}
+
+/* `ParallelWalker` traverses the directories below a root directory on several threads, and
+collects the paths of the files that match a `GlobMatcher`. The directories that remain to be
+listed are kept in one queue: each thread takes a directory from it, lists the directory, and then
+adds the subdirectories that may contain matches to it. The traversal ends when the queue is empty
+and no thread is listing a directory, or at the first error. Threads are started as the queue
+grows, while there are more directories queued than threads waiting for them (up to
+`std::thread::hardware_concurrency()`), so that a small tree starts few threads. Each thread
+collects the paths it finds in its own `FoundPaths`, so that the threads only share the queue. */
+class ParallelWalker {
+    const GlobMatcher &matcher;
+    std::mutex mutex;
+    std::condition_variable queue_changed;
+    std::vector<Directory> queue;
+    std::size_t num_listing = 0;
+    std::size_t max_threads = std::max(std::thread::hardware_concurrency(), 1u);
+    std::size_t num_threads = 1;
+    std::vector<std::jthread> workers;
+    std::deque<FoundPaths> thread_found;  /* a deque, so that adding one moves no other */
+    std::string error;  /* the first error, or empty */
+
+    /* Lists the directory `directory`, adding the paths of the matching files in it to `found`,
+    and the subdirectories that may contain matches to `subdirectories`. Directories below the root
+    that cannot be opened (e.g. for lack of permission) are skipped. Returns `false`, with the
+    reason in `list_error`, if the directory is the root and cannot be opened, or if reading it
+    failed. */
+    auto list(
+        const Directory &directory,
+        bool is_root,
+        FoundPaths &found,
+        std::vector<Directory> &subdirectories,
+        std::string &list_error
+    ) -> bool {
+        auto visit = [&](std::string_view name, bool is_directory, bool is_file) {
+            auto mask = matcher.next(directory.mask, name, is_directory);
+            if (is_file && (mask & matcher.complete_bit())) {
+                found.add(directory.path, name);
+            } else if (is_directory && mask != 0) {
+                auto path = directory.path;
+                if (!path.empty() && !path.ends_with('/')) {
+                    path.push_back('/');
+                }
+                path.append(name);
+                subdirectories.push_back({std::move(path), mask});
+            }
+        };
+        std::string reason;
+        auto result = list_directory(directory.path, reason, visit);
+        if (result == ListResult::cannot_read ||
+            (result == ListResult::cannot_open && is_root)) {
+            list_error = std::format(
+                "cannot list the directory {}: {}",
+                directory_name(directory.path), reason
+            );
+            return false;
+        }
+        return true;
+    }
+
+    /* Starts a thread that walks the queue, collecting its paths in a `FoundPaths` of its own.
+    `mutex` must be locked. */
+    void start_thread() {
+        ++num_threads;
+        workers.emplace_back([this, &paths = thread_found.emplace_back()] { walk(paths); });
+    }
+
+    void walk(FoundPaths &found) {
+        std::vector<Directory> subdirectories;
+        std::string list_error;
+        std::unique_lock lock(mutex);
+        while (true) {
+            queue_changed.wait(lock, [&] { return !queue.empty() || num_listing == 0; });
+            if (queue.empty()) {
+                return;
+            }
+            auto directory = std::move(queue.back());
+            queue.pop_back();
+            ++num_listing;
+            lock.unlock();
+
+            auto listed = list(directory, false, found, subdirectories, list_error);
+
+            lock.lock();
+            --num_listing;
+            if (!listed) {
+                /* Stop the traversal: the other threads return once they finish their directories
+                and see an empty queue */
+                if (error.empty()) {
+                    error = std::move(list_error);
+                }
+                queue.clear();
+            } else if (error.empty()) {
+                for (auto &subdirectory : subdirectories) {
+                    queue.push_back(std::move(subdirectory));
+                }
+                while (queue.size() > num_threads - num_listing && num_threads < max_threads) {
+                    start_thread();
+                }
+            }
+            subdirectories.clear();
+            queue_changed.notify_all();
+        }
+    }
+
+public:
+
+    explicit ParallelWalker(const GlobMatcher &matcher) : matcher(matcher) {}
+
+    /* Traverses the directory `root` (in the state `mask`) and the directories below it, and adds
+    the paths of the matching files to `found` (with one `FoundPaths` per thread). Returns `false`,
+    with the reason in `walk_error`, if a directory could not be listed (see `list`). */
+    auto run(Directory root, std::vector<FoundPaths> &found, std::string &walk_error) -> bool {
+        /* List directories on this thread alone for as long as there is only one to list at a
+        time, so that entries that only list one directory (such as `*.obj`), or a chain of single
+        directories, never start threads */
+        auto &first_found = thread_found.emplace_back();
+        queue.push_back(std::move(root));
+        for (bool is_root = true; queue.size() == 1; is_root = false) {
+            auto directory = std::move(queue.back());
+            queue.pop_back();
+            if (!list(directory, is_root, first_found, queue, walk_error)) {
+                return false;
+            }
+        }
+
+        if (!queue.empty()) {
+            {
+                std::lock_guard lock(mutex);
+                while (num_threads < std::min(max_threads, queue.size())) {
+                    start_thread();
+                }
+            }
+            walk(first_found);
+
+            /* No thread starts another once the traversal has ended, so `workers` holds every
+            thread that was started */
+            std::vector<std::jthread> finished_workers;
+            {
+                std::lock_guard lock(mutex);
+                finished_workers.swap(workers);
+            }
+        }
+
+        for (auto &paths : thread_found) {
+            found.push_back(std::move(paths));
+        }
+        if (!error.empty()) {
+            walk_error = std::move(error);
+            return false;
+        }
+        return true;
+    }
+};
+
+/* Returns the number of paths in `found` */
+auto count_paths(const std::vector<FoundPaths> &found) -> std::size_t {
+    std::size_t num_paths = 0;
+    for (const auto &thread_found : found) {
+        num_paths += thread_found.paths.size();
+    }
+    return num_paths;
+}
+
+/* Splits the entry `entry` of a path list into the components before its first component with a
+wildcard, which name the directory `root` where the traversal starts, and the components from there
+on, which are matched by `matcher` during the traversal. Returns `false`, with the reason in
+`error`, if the entry is not a valid pattern. */
+auto split_entry(
+    std::string_view entry, std::string &root, GlobMatcher &matcher, std::string &error
+) -> bool {
+    for (std::size_t start = 0; start <= entry.size();) {
+        auto end = std::min(entry.find('/', start), entry.size());
+        auto component = entry.substr(start, end - start);
+        if (!matcher.components.empty() || has_wildcard(component)) {
+            if (has_unterminated_class(component)) {
+                error = std::format(
+                    "the pattern component {} has a [ without a matching ]", component
+                );
+                return false;
+            }
+            if (!component.empty()) {
+                matcher.components.push_back(component);
+            }
+        } else if (end < entry.size()) {
+            root.append(entry.substr(start, end + 1 - start));
+        } else {
+            root.append(component);
+        }
+        start = end + 1;
+    }
+    if (matcher.components.size() > max_pattern_components) {
+        error = std::format("the pattern has more than {} components", max_pattern_components);
+        return false;
+    }
+    return true;
+}
+
+/* Expands the entry `entry` of a path list (a glob pattern, a directory, or a file), adding the
+paths of the files it stands for to `found`. Returns `false`, with the reason in `error`, if it
+stands for no files. */
+auto expand_entry(
+    std::string_view entry,
+    std::vector<FoundPaths> &found,
+    std::string &error
+) -> bool {
+    std::string root;
+    GlobMatcher matcher;
+    if (!split_entry(entry, root, matcher, error)) {
+        return false;
+    }
+
+#ifdef CPP_ARGUMENT_PARSER_FUZZING
+    /* The fuzz target must not traverse whatever directories its inputs name (such as `/**`), so
+    there, only the syntax of the entry is checked, and it stands for no files */
+    return true;
+#else
+
+    /* Without wildcards, the entry is a directory or a file */
+    std::error_code error_code;
+    if (matcher.components.empty()) {
+        auto status = std::filesystem::status(std::filesystem::path(root), error_code);
+        if (std::filesystem::is_regular_file(status)) {
+            found.emplace_back().add("", root);
+            return true;
+        } else if (!std::filesystem::is_directory(status)) {
+            error = "no such file or directory";
+            return false;
+        }
+    }
+
+    /* Otherwise, traverse the directory (every file below it matches if the entry is a directory;
+    see `GlobMatcher`) */
+    if (!std::filesystem::is_directory(root.empty() ? "." : root, error_code)) {
+        error = std::format("no such directory {}", root.empty() ? "." : root);
+        return false;
+    }
+    auto num_paths_before = count_paths(found);
+    if (!ParallelWalker(matcher).run({root, matcher.closure(1)}, found, error)) {
+        return false;
+    }
+    if (count_paths(found) == num_paths_before) {
+        error = "no files match";
+        return false;
+    }
+    return true;
+#endif
+}
+
+}
+
+auto PathList::assign(std::string_view argument, std::string &error) -> bool {
+    std::vector<FoundPaths> found;
+    for (std::size_t start = 0; start <= argument.size();) {
+        auto end = std::min(argument.find(path_list_separator, start), argument.size());
+        auto entry = argument.substr(start, end - start);
+        if (!entry.empty() && !expand_entry(entry, found, error)) {
+            error = std::format("{} ({})", entry, error);
+            return false;
+        }
+        start = end + 1;
+    }
+
+    /* Sort the paths found by all threads, and store them in one arena */
+    std::vector<std::string_view> paths;
+    for (const auto &thread_found : found) {
+        for (auto [offset, size] : thread_found.paths) {
+            paths.push_back(std::string_view(thread_found.text).substr(offset, size));
+        }
+    }
+    std::sort(paths.begin(), paths.end());
+    paths.erase(std::unique(paths.begin(), paths.end()), paths.end());
+    if (paths.empty()) {
+        arena.reset();
+        return true;
+    }
+
+    auto new_arena = std::make_shared<PathArena>();
+    std::size_t text_size = 0;
+    for (auto path : paths) {
+        text_size += path.size() + 1;
+    }
+    new_arena->text.reserve(text_size);
+    new_arena->offsets.reserve(paths.size() + 1);
+    for (auto path : paths) {
+        new_arena->offsets.push_back(new_arena->text.size());
+        new_arena->text.append(path);
+        new_arena->text.push_back('\0');
+    }
+    new_arena->offsets.push_back(new_arena->text.size());
+    arena = std::move(new_arena);
+    return true;
+}
+
+auto PathList::size() const -> std::size_t {
+    return arena ? arena->offsets.size() - 1 : 0;
+}
+
+auto PathList::operator[](std::size_t index) const -> std::string_view {
+    auto start = arena->offsets[index];
+    return std::string_view(arena->text).substr(start, arena->offsets[index + 1] - start - 1);
+}
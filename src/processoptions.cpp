@@ -0,0 +1,112 @@
+#include "processoptions.h"
+#include <atomic>
+
+#if defined(CPP_ARGUMENT_PARSER_IS_ON_WINDOWS)
+/* `CommandLineOptions` gets the arguments from `GetCommandLineW()` itself on Windows */
+#elif defined(__APPLE__)
+#include <crt_externs.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <string>
+#include <unistd.h>
+#include <vector>
+#endif
+
+namespace {
+
+/* The published options, or `nullptr` before the first call to `process_command_line_options` */
+std::atomic<const CommandLineOptions *> published_options = nullptr;
+
+#if !defined(CPP_ARGUMENT_PARSER_IS_ON_WINDOWS) && !defined(__APPLE__)
+
+/* The `argc` and `argv` of the process, if they were captured by `capture_arguments` */
+int captured_argc = 0;
+char **captured_argv = nullptr;
+
+/* glibc calls every function in `.init_array` with the same `argc`, `argv`, and `envp` as `main`
+(in shared libraries too). This one runs before the constructors of global objects with the
+default priority, so that those constructors can use the captured arguments. Other C runtimes
+(e.g. musl) call these functions without arguments, so we only use them with glibc. */
+#ifdef __GLIBC__
+void capture_arguments(int argc, char **argv, char **) {
+    captured_argc = argc;
+    captured_argv = argv;
+}
+
+[[gnu::used, gnu::section(".init_array.00101")]]
+void (*const capture_arguments_entry)(int, char **, char **) = &capture_arguments;
+#endif
+
+/* Returns the contents of /proc/self/cmdline (the arguments of the process, each followed by a
+NUL character), or an empty string if it cannot be read. Files in /proc cannot be mapped into
+memory, so we read it in a loop. */
+auto read_proc_self_cmdline() -> std::string {
+    std::string contents;
+    int fd = ::open("/proc/self/cmdline", O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return contents;
+    }
+    char buffer[4096];
+    while (true) {
+        auto count = ::read(fd, buffer, sizeof(buffer));
+        if (count < 0 && errno == EINTR) {
+            continue;
+        } else if (count <= 0) {
+            break;
+        }
+        contents.append(buffer, static_cast<std::size_t>(count));
+    }
+    ::close(fd);
+    return contents;
+}
+
+#endif
+
+/* Parses the command-line arguments of the process */
+auto parse_process_arguments() -> const CommandLineOptions * {
+#if defined(CPP_ARGUMENT_PARSER_IS_ON_WINDOWS)
+    return new CommandLineOptions(0, nullptr);
+#elif defined(__APPLE__)
+    return new CommandLineOptions(*_NSGetArgc(), *_NSGetArgv());
+#else
+    if (captured_argv) {
+        return new CommandLineOptions(captured_argc, captured_argv);
+    }
+
+    /* Otherwise, split /proc/self/cmdline into arguments. `CommandLineOptions` only reads the
+    arguments while it is being constructed, so they only need to live until then. If
+    /proc/self/cmdline cannot be read, `argc` is 0, and no arguments are parsed. */
+    auto cmdline = read_proc_self_cmdline();
+    if (!cmdline.empty() && cmdline.back() != '\0') {
+        cmdline.push_back('\0');  /* Older kernels truncate /proc/self/cmdline to one page */
+    }
+    std::vector<char *> argv;
+    for (std::size_t i = 0; i < cmdline.size(); i = cmdline.find('\0', i) + 1) {
+        argv.push_back(cmdline.data() + i);
+    }
+    auto argc = static_cast<int>(argv.size());
+    argv.push_back(nullptr);
+    return new CommandLineOptions(argc, argv.data());
+#endif
+}
+
+}
+
+auto process_command_line_options() -> const CommandLineOptions & {
+    if (auto options = published_options.load(std::memory_order_acquire)) {
+        return *options;
+    }
+
+    /* Parse the arguments, then publish the result, unless another thread published its own
+    result first (in which case we use that one instead) */
+    auto options = parse_process_arguments();
+    const CommandLineOptions *expected = nullptr;
+    if (!published_options.compare_exchange_strong(
+        expected, options, std::memory_order_acq_rel, std::memory_order_acquire
+    )) {
+        delete options;
+        return *expected;
+    }
+    return *options;
+}
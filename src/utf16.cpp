@@ -0,0 +1,124 @@
+#include "utf16.h"
+#include <cstdint>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define CPP_ARGUMENT_PARSER_UTF16_SSE2
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#include <arm_neon.h>
+#define CPP_ARGUMENT_PARSER_UTF16_NEON
+#endif
+
+namespace {
+
+/* The number of code units converted at a time by the vectorized paths */
+constexpr std::size_t block_size = 8;
+
+/* Converts one block of `block_size` code units at `input` to UTF-8 at `output`, if they are all
+ASCII or all in U+0080 to U+07FF, returning the number of bytes written (8 or 16). Otherwise,
+writes nothing and returns 0. */
+auto transcode_block(const char16_t *input, char *output) -> std::size_t {
+#if defined(CPP_ARGUMENT_PARSER_UTF16_SSE2)
+    auto units = _mm_loadu_si128(reinterpret_cast<const __m128i *>(input));
+    auto zero = _mm_setzero_si128();
+
+    /* Bail out early if any code unit needs three bytes (or is a surrogate) */
+    auto is_one_or_two_bytes = _mm_cmpeq_epi16(_mm_and_si128(units, _mm_set1_epi16(-0x800)), zero);
+    if (_mm_movemask_epi8(is_one_or_two_bytes) != 0xFFFF) {
+        return 0;
+    }
+
+    /* All ASCII: narrow every code unit to its low byte */
+    auto is_ascii = _mm_cmpeq_epi16(_mm_and_si128(units, _mm_set1_epi16(-0x80)), zero);
+    if (auto ascii_mask = _mm_movemask_epi8(is_ascii); ascii_mask == 0xFFFF) {
+        _mm_storel_epi64(reinterpret_cast<__m128i *>(output), _mm_packus_epi16(units, units));
+        return block_size;
+    } else if (ascii_mask == 0) {
+        /* All in U+0080 to U+07FF: every code unit `u` becomes the two bytes `0xC0 | (u >> 6)`
+        and `0x80 | (u & 0x3F)`, which (in little-endian order) is the 16-bit word built below */
+        auto lead = _mm_or_si128(_mm_srli_epi16(units, 6), _mm_set1_epi16(0xC0));
+        auto trail = _mm_or_si128(_mm_and_si128(units, _mm_set1_epi16(0x3F)), _mm_set1_epi16(0x80));
+        _mm_storeu_si128(
+            reinterpret_cast<__m128i *>(output), _mm_or_si128(lead, _mm_slli_epi16(trail, 8))
+        );
+        return 2 * block_size;
+    }
+#elif defined(CPP_ARGUMENT_PARSER_UTF16_NEON)
+    uint16x8_t units;
+    std::memcpy(&units, input, sizeof(units));
+
+    if (vmaxvq_u16(units) < 0x80) {
+        vst1_u8(reinterpret_cast<std::uint8_t *>(output), vmovn_u16(units));
+        return block_size;
+    }
+
+    if (vminvq_u16(units) >= 0x80 && vmaxvq_u16(units) < 0x800) {
+        auto lead = vorrq_u16(vshrq_n_u16(units, 6), vdupq_n_u16(0xC0));
+        auto trail = vorrq_u16(vandq_u16(units, vdupq_n_u16(0x3F)), vdupq_n_u16(0x80));
+        vst2_u8(
+            reinterpret_cast<std::uint8_t *>(output),
+            uint8x8x2_t{{vmovn_u16(lead), vmovn_u16(trail)}}
+        );
+        return 2 * block_size;
+    }
+#else
+    (void)input;
+    (void)output;
+#endif
+    return 0;
+}
+
+}
+
+auto transcode_utf16_to_utf8(std::u16string_view input, char *output) -> std::size_t {
+    auto out = output;
+    std::size_t i = 0;
+
+    /* Convert blocks with the vectorized path for as long as it can convert them. Text that it
+    cannot convert (such as CJK, whose characters all take three bytes) tends to continue to the
+    end of the argument, and checking every block of it only to fall back to the scalar path made
+    it slower than the scalar path alone. So once a block fails the check, the rest of `input` is
+    converted by the scalar path. */
+    while (input.size() - i >= block_size) {
+        auto written = transcode_block(input.data() + i, out);
+        if (written == 0) {
+            break;
+        }
+        out += written;
+        i += block_size;
+    }
+
+    /* Convert the rest of `input` (including the last code units, if fewer than a block) one code
+    point at a time */
+    while (i < input.size()) {
+        std::uint32_t code_point = input[i++];
+        if (code_point >= 0xD800 && code_point <= 0xDFFF) {
+            /* A high surrogate followed by a low surrogate encodes a code point above
+            U+FFFF; any other surrogate is unpaired, and is replaced with U+FFFD */
+            if (code_point <= 0xDBFF && i < input.size() && input[i] >= 0xDC00 &&
+                input[i] <= 0xDFFF) {
+                code_point = 0x10000 + ((code_point - 0xD800) << 10) + (input[i++] - 0xDC00u);
+            } else {
+                code_point = 0xFFFD;
+            }
+        }
+
+        if (code_point < 0x80) {
+            *out++ = static_cast<char>(code_point);
+        } else if (code_point < 0x800) {
+            *out++ = static_cast<char>(0xC0 | (code_point >> 6));
+            *out++ = static_cast<char>(0x80 | (code_point & 0x3F));
+        } else if (code_point < 0x10000) {
+            *out++ = static_cast<char>(0xE0 | (code_point >> 12));
+            *out++ = static_cast<char>(0x80 | ((code_point >> 6) & 0x3F));
+            *out++ = static_cast<char>(0x80 | (code_point & 0x3F));
+        } else {
+            *out++ = static_cast<char>(0xF0 | (code_point >> 18));
+            *out++ = static_cast<char>(0x80 | ((code_point >> 12) & 0x3F));
+            *out++ = static_cast<char>(0x80 | ((code_point >> 6) & 0x3F));
+            *out++ = static_cast<char>(0x80 | (code_point & 0x3F));
+        }
+    }
+    return static_cast<std::size_t>(out - output);
+}
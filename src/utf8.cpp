@@ -0,0 +1,118 @@
+#include "utf8.h"
+#include <cstdint>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define CPP_ARGUMENT_PARSER_UTF8_SSE2
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#include <arm_neon.h>
+#define CPP_ARGUMENT_PARSER_UTF8_NEON
+#endif
+
+namespace {
+
+/* The number of bytes checked at a time by the ASCII fast path */
+constexpr std::size_t block_size = 32;
+
+/* Returns whether the `block_size` bytes at `bytes` are all ASCII */
+auto is_ascii_block(const char *bytes) -> bool {
+#if defined(CPP_ARGUMENT_PARSER_UTF8_SSE2)
+    auto first = _mm_loadu_si128(reinterpret_cast<const __m128i *>(bytes));
+    auto second = _mm_loadu_si128(reinterpret_cast<const __m128i *>(bytes + 16));
+    return _mm_movemask_epi8(_mm_or_si128(first, second)) == 0;
+#elif defined(CPP_ARGUMENT_PARSER_UTF8_NEON)
+    auto first = vld1q_u8(reinterpret_cast<const std::uint8_t *>(bytes));
+    auto second = vld1q_u8(reinterpret_cast<const std::uint8_t *>(bytes + 16));
+    return vmaxvq_u8(vorrq_u8(first, second)) < 0x80;
+#else
+    /* Without SIMD, check eight bytes at a time in 64-bit words */
+    std::uint64_t word = 0;
+    for (std::size_t i = 0; i < block_size; i += sizeof(word)) {
+        std::uint64_t part;
+        std::memcpy(&part, bytes + i, sizeof(part));
+        word |= part;
+    }
+    return (word & 0x8080808080808080) == 0;
+#endif
+}
+
+/* Returns the length of the valid UTF-8 sequence that begins `text` at `i` (which must be less
+than `text.size()`), or 0 if there is no valid sequence there. The allowed bytes are those of
+Table 3-7 of the Unicode Standard ("Well-Formed UTF-8 Byte Sequences"). */
+auto valid_sequence_length(std::string_view text, std::size_t i) -> std::size_t {
+    auto byte = [&](std::size_t offset) -> unsigned {
+        return i + offset < text.size() ? static_cast<unsigned char>(text[i + offset]) : 0u;
+    };
+    auto is_continuation = [](unsigned b, unsigned low = 0x80, unsigned high = 0xBF) {
+        return b >= low && b <= high;
+    };
+
+    auto lead = byte(0);
+    if (lead < 0x80) {
+        return 1;
+    } else if (lead >= 0xC2 && lead <= 0xDF) {
+        return is_continuation(byte(1)) ? 2 : 0;
+    } else if (lead >= 0xE0 && lead <= 0xEF) {
+        /* E0 must not be overlong (second byte A0..BF), and ED must not encode a surrogate
+        (second byte 80..9F) */
+        auto low = lead == 0xE0 ? 0xA0u : 0x80u;
+        auto high = lead == 0xED ? 0x9Fu : 0xBFu;
+        return is_continuation(byte(1), low, high) && is_continuation(byte(2)) ? 3 : 0;
+    } else if (lead >= 0xF0 && lead <= 0xF4) {
+        /* F0 must not be overlong (second byte 90..BF), and F4 must not exceed U+10FFFF (second
+        byte 80..8F) */
+        auto low = lead == 0xF0 ? 0x90u : 0x80u;
+        auto high = lead == 0xF4 ? 0x8Fu : 0xBFu;
+        return is_continuation(byte(1), low, high) && is_continuation(byte(2)) &&
+               is_continuation(byte(3)) ? 4 : 0;
+    }
+    return 0;
+}
+
+}
+
+auto find_invalid_utf8(std::string_view text) -> std::size_t {
+    /* Most arguments are shorter than a block; check those eight bytes at a time (the last eight
+    overlapping the previous ones), and fall through to the full check if they are not ASCII */
+    if (text.size() < block_size && text.size() >= sizeof(std::uint64_t)) {
+        std::uint64_t word = 0, part;
+        for (std::size_t i = 0; i + sizeof(part) <= text.size(); i += sizeof(part)) {
+            std::memcpy(&part, text.data() + i, sizeof(part));
+            word |= part;
+        }
+        std::memcpy(&part, text.data() + text.size() - sizeof(part), sizeof(part));
+        if (((word | part) & 0x8080808080808080) == 0) {
+            return std::string_view::npos;
+        }
+    }
+
+    std::size_t i = 0;
+    while (i < text.size()) {
+        /* Skip blocks of ASCII first. If fewer than `block_size` bytes remain, check the last
+        `block_size` bytes of `text` instead (which overlap bytes that were already validated). */
+        while (text.size() - i >= block_size && is_ascii_block(text.data() + i)) {
+            i += block_size;
+        }
+        if (text.size() - i < block_size && text.size() >= block_size &&
+            is_ascii_block(text.data() + text.size() - block_size)) {
+            break;
+        }
+
+        /* Then check the rest of the block (or of `text`) one sequence at a time. A sequence may
+        extend past the end of the block. */
+        auto block_end = text.size() - i >= block_size ? i + block_size : text.size();
+        while (i < block_end) {
+            if (static_cast<unsigned char>(text[i]) < 0x80) {
+                ++i;
+                continue;
+            }
+            auto length = valid_sequence_length(text, i);
+            if (length == 0) {
+                return i;
+            }
+            i += length;
+        }
+    }
+    return std::string_view::npos;
+}
@@ -0,0 +1,23 @@
+#include "nameindex.h"
+#include <string_view>
+
+/* This file must NOT compile: `imageFile` and `image-file` have the same key (see
+`fold_option_name` in src/nameindex.h), and `OptionKeys` rejects option names with the same key
+when it computes their keys at compile time. scripts/run_tests.sh builds it (as the
+`cpp_argument_parser_loose_name_collision` target, which is excluded from the default build) and
+checks that the compiler reports the duplicate key. */
+
+namespace {
+
+struct Name {
+    std::string_view name;
+};
+
+constexpr auto option_keys = OptionKeys<19, 2>(Name{"imageFile"}, Name{"image-file"});
+
+}
+
+int main()
+{
+    return static_cast<int>(option_keys.max_size);
+}
@@ -0,0 +1,699 @@
+#include "argumentparser.h"
+#include "nameindex.h"
+#include "optionsoverlay.h"
+#include "optionssnapshot.h"
+#include "output.h"
+#include "utf16.h"
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <format>
+#include <optional>
+#include <random>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#ifdef __GLIBC__
+#include "getopt_compat.h"
+#include <cstdio>
+#include <getopt.h>
+#include <unistd.h>
+#endif
+
+#ifdef CPP_ARGUMENT_PARSER_FORK_SERVER
+#include "forkserver.h"
+#include <csignal>
+#include <cstring>
+#include <stdexcept>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+/* `cpp_argument_parser_unit_tests` tests the parts of the parser that cannot be reached through
+the command line of `cpp_argument_parser`. Each test is selected by its name (the first argument),
+is given the arguments from its name on (as `argc` and `argv`), and writes what it observes to
+`stdout`, which scripts/run_tests.sh compares with the expected output of the test in tests/, as for
+`cpp_argument_parser`. The parser is compiled with `CPP_ARGUMENT_PARSER_THROW_ON_ERROR` here (see
+CMakeLists.txt), so that a test can check an error and carry on, and with
+`CPP_ARGUMENT_PARSER_TESTING`, which adds the test-only options (see include/argumentparser.h). */
+
+namespace {
+
+/* Converts `input` to UTF-8 one code point at a time, as a reference for `transcode_utf16_to_utf8`
+*/
+auto reference_transcode(std::u16string_view input) -> std::string {
+    std::string output;
+    for (std::size_t i = 0; i < input.size(); ++i) {
+        std::uint32_t c = input[i];
+        if (c >= 0xD800 && c <= 0xDBFF && i + 1 < input.size() && input[i + 1] >= 0xDC00 &&
+            input[i + 1] <= 0xDFFF) {
+            c = 0x10000 + ((c - 0xD800) << 10) + (input[++i] - 0xDC00u);
+        } else if (c >= 0xD800 && c <= 0xDFFF) {
+            c = 0xFFFD;
+        }
+        if (c < 0x80) {
+            output += static_cast<char>(c);
+        } else if (c < 0x800) {
+            output += static_cast<char>(0xC0 | (c >> 6));
+            output += static_cast<char>(0x80 | (c & 0x3F));
+        } else if (c < 0x10000) {
+            output += static_cast<char>(0xE0 | (c >> 12));
+            output += static_cast<char>(0x80 | ((c >> 6) & 0x3F));
+            output += static_cast<char>(0x80 | (c & 0x3F));
+        } else {
+            output += static_cast<char>(0xF0 | (c >> 18));
+            output += static_cast<char>(0x80 | ((c >> 12) & 0x3F));
+            output += static_cast<char>(0x80 | ((c >> 6) & 0x3F));
+            output += static_cast<char>(0x80 | (c & 0x3F));
+        }
+    }
+    return output;
+}
+
+auto transcode(std::u16string_view input) -> std::string {
+    std::string output(utf8_size_upper_bound(input.size()), '\0');
+    output.resize(transcode_utf16_to_utf8(input, output.data()));
+    return output;
+}
+
+/* Tests `transcode_utf16_to_utf8` on text that takes each of its paths (blocks of ASCII and of
+two-byte characters, the scalar path after a block it cannot convert, and the code units after the
+last whole block), and then against `reference_transcode` on random text. */
+void test_utf16(int, char **) {
+    const std::pair<std::string_view, std::u16string_view> cases[] = {
+        {"empty", u""},
+        {"short ascii", u"abc"},
+        {"ascii blocks", u"--imagefile=render.ppm"},
+        {"two-byte blocks", u"приветмирпривет!"},
+        {"cjk", u"日本語のテキストと漢字"},
+        {"ascii then cjk then ascii", u"--input=場面ファイル.txt"},
+        {"surrogate pair", u"emoji \U0001F600"},
+        {"pair across a block", u"1234567\U0001F600890"},
+        {"unpaired high", u"a\xD83D" u"bcdefghij"},
+        {"unpaired low", u"\xDE00" u"abcdefgh"},
+        {"high at end", u"abcdefgh\xD83D"},
+    };
+    for (auto [name, input] : cases) {
+        auto output = transcode(input);
+        write_stdout(std::format(
+            "{}: {} code units -> {} bytes [{}]{}\n", name, input.size(), output.size(), output,
+            output == reference_transcode(input) ? "" : " MISMATCH"
+        ));
+    }
+
+    /* Runs of each range make the vectorized paths likely to be taken */
+    const std::pair<char16_t, char16_t> ranges[] = {
+        {0x20, 0x7E}, {0x80, 0x7FF}, {0x800, 0xD7FF}, {0xD800, 0xDBFF}, {0xDC00, 0xDFFF},
+        {0xE000, 0xFFFF}, {0x0, 0xFFFF}
+    };
+    std::mt19937 rng(1);
+    int mismatches = 0;
+    for (int test = 0; test < 20'000; ++test) {
+        std::u16string input;
+        for (int run = 0; run < 4; ++run) {
+            auto [first, last] = ranges[rng() % std::size(ranges)];
+            for (auto length = rng() % 20; length > 0; --length) {
+                input += static_cast<char16_t>(first + rng() % (last - first + 1u));
+            }
+        }
+        mismatches += transcode(input) != reference_transcode(input);
+    }
+    write_stdout(std::format("random: {} mismatches in 20000 inputs\n", mismatches));
+}
+
+/* Tests parsing an empty `argv` (as a process started with no arguments at all gets, and as
+`process_command_line_options` passes when it cannot read the arguments of the process), which
+leaves every option at its default value */
+void test_empty_argv(int, char **) {
+    char *argv[] = {nullptr};
+    CommandLineOptions options(0, argv);
+    write_stdout(std::format("Parsed options: {}", options));
+}
+
+/* Returns `path` as UTF-8 text (the encoding of the command-line arguments it was parsed from, on
+every platform) */
+auto format_path(const std::filesystem::path &path) -> std::string {
+    auto utf8_path = path.u8string();
+    return std::string(utf8_path.begin(), utf8_path.end());
+}
+
+/* Returns the value of `option` as text, or "unset" if no value was given for it */
+template <typename T>
+auto format_optional(const std::optional<T> &option) -> std::string {
+    return option ? std::format("{}", *option) : std::string("unset");
+}
+
+/* Tests parsing the arguments after the name of the test (`argv[0]`, which is skipped like the
+executable) into the test-only options, which are printed (or the error in the arguments, as
+`cpp_argument_parser` would print it) */
+void test_options(int argc, char **argv) {
+    try {
+        CommandLineOptions options(argc, argv);
+        write_stdout(std::format(
+            "Test options: {{\n"
+            "    tile_size: {},\n"
+            "    job_name: {},\n"
+            "    scene_text: {},\n"
+            "    scene_paths: {},\n"
+            "    frame: {},\n"
+            "    max_depth: {},\n"
+            "    output_dir: {}\n"
+            "}}\n",
+            options.tile_size, options.job_name, options.scene_text, options.scene_paths,
+            format_optional(options.frame), options.max_depth, format_path(options.output_dir)
+        ));
+    } catch (const CommandLineOptionsError &error) {
+        write_stdout(std::format("{}\n", error.what()));
+    }
+}
+
+/* Tests `fold_option_name` (src/nameindex.h), which computes the keys that option names are matched
+by in loose name mode, by printing the key of each argument after the name of the test */
+void test_loose_names(int argc, char **argv) {
+    for (int i = 1; i < argc; ++i) {
+        auto name = std::string_view(argv[i]);
+        std::string key(name.size(), '\0');
+        key.resize(fold_option_name(name, key.data()));
+        write_stdout(std::format("{} -> {}\n", name, key));
+    }
+}
+
+/* Parses `arguments` with the constructor (which, with `CPP_ARGUMENT_PARSER_PARALLEL_PARSE`, parses
+them in chunks on several threads) and with `CommandLineOptions::try_parse` (which always parses
+them sequentially), and prints whether the two parses agree on the options or on the error */
+void compare_parallel_parse(
+    std::string_view description, const std::vector<std::string> &arguments
+) {
+    std::vector<char *> argv = {const_cast<char *>("cpp_argument_parser")};
+    std::vector<std::string_view> argument_views;
+    for (const auto &argument : arguments) {
+        argv.push_back(const_cast<char *>(argument.c_str()));
+        argument_views.push_back(argument);
+    }
+    auto argc = static_cast<int>(argv.size());
+    argv.push_back(nullptr);
+
+    std::string parallel_result, sequential_result;
+    try {
+        parallel_result = std::format("{}", CommandLineOptions(argc, argv.data()));
+    } catch (const CommandLineOptionsError &error) {
+        parallel_result = error.what();
+    }
+    if (auto options = CommandLineOptions::try_parse(argument_views, sequential_result)) {
+        sequential_result = std::format("{}", *options);
+    }
+    write_stdout(std::format(
+        "{}: parallel and sequential parses {}\n", description,
+        parallel_result == sequential_result ? "agree" : "DIFFER"
+    ));
+}
+
+/* Tests that a parallel parse of many arguments (enough for several chunks; see
+`CommandLineOptions::parse_in_parallel`) has the same result as a sequential parse, for arguments
+where options given later must win, where values may be split from their options at the end of a
+chunk, and where errors are raised in several chunks */
+void test_parallel(int, char **) {
+    std::vector<std::string> arguments;
+    for (int i = 0; arguments.size() < 100'000; ++i) {
+        arguments.insert(arguments.end(), {
+            "--nthreads", std::to_string(i), std::format("--spp={}", i % 1000), "-s",
+            std::to_string(i * 7), "--imagefile", std::format("render_{}.ppm", i),
+            std::format("--input=scene_{}.txt", i), "-qp", "--partial=false", "--logutil",
+            i % 2 ? "true" : "false", "-q"
+        });
+    }
+    arguments.push_back("--logutil=false");
+    compare_parallel_parse("valid arguments", arguments);
+
+    arguments[arguments.size() / 5] = "--nthreads=many";
+    arguments[arguments.size() / 2] = "--unknown";
+    arguments[arguments.size() * 4 / 5] = "-x";
+    arguments.push_back("--spp");
+    compare_parallel_parse("errors in several chunks", arguments);
+}
+
+/* Tests `CommandLineOptions::parse_stats()` by printing the allocation statistics of parsing the
+arguments after the name of the test */
+void test_parse_stats(int argc, char **argv) {
+    CommandLineOptions options(argc, argv);
+    const auto &stats = options.parse_stats();
+    write_stdout(std::format(
+        "allocations: {}, bytes: {}, peak: {}\n", stats.allocations, stats.bytes, stats.peak
+    ));
+}
+
+/* Tests that output is not lost when the process ends without flushing it (as after a crash or
+an `abort`): text written to `stdout` is flushed before text written to `stderr`, which is written
+at once, so both are printed, in order, even though the process then ends with `std::_Exit` */
+void test_output(int, char **) {
+    write_stdout("Written to stdout before the error\n");
+    write_stderr("Error: written to stderr just before the process ends\n");
+    std::_Exit(1);
+}
+
+/* Returns the names of the options in `changes`, separated by spaces (or "none") */
+auto format_changes(const OptionChanges &changes) -> std::string {
+    const std::pair<std::string_view, bool> options[] = {
+        {"nthreads", changes.contains<&CommandLineOptions::nthreads>()},
+        {"spp", changes.contains<&CommandLineOptions::spp>()},
+        {"seed", changes.contains<&CommandLineOptions::seed>()},
+        {"image_file", changes.contains<&CommandLineOptions::image_file>()},
+        {"input_file", changes.contains<&CommandLineOptions::input_file>()},
+        {"quiet", changes.contains<&CommandLineOptions::quiet>()},
+        {"log_util", changes.contains<&CommandLineOptions::log_util>()},
+        {"partial", changes.contains<&CommandLineOptions::partial>()},
+        {"max_depth", changes.contains<&CommandLineOptions::max_depth>()},
+    };
+    std::string names;
+    for (auto [name, changed] : options) {
+        if (changed) {
+            names += names.empty() ? "" : " ";
+            names += name;
+        }
+    }
+    return names.empty() ? "none" : names;
+}
+
+/* Applies the arguments `delta` to `options` with `CommandLineOptions::apply`, and prints the
+options it changed (or the error in `delta`) and the options after it */
+void apply_delta(CommandLineOptions &options, std::vector<std::string_view> delta) {
+    std::string arguments;
+    for (auto argument : delta) {
+        arguments += arguments.empty() ? "" : " ";
+        arguments += argument;
+    }
+    try {
+        auto changes = options.apply(delta);
+        write_stdout(std::format(
+            "apply {}: {} changed: {}\n", arguments, changes.size(), format_changes(changes)
+        ));
+    } catch (const CommandLineOptionsError &error) {
+        write_stdout(std::format("apply {}: {}\n", arguments, error.what()));
+    }
+    write_stdout(std::format("Options: {}", options));
+}
+
+/* Parses `arguments` with `CommandLineOptions::try_parse`, and prints the options, or the error */
+void try_parse_arguments(std::vector<std::string_view> arguments) {
+    std::string error;
+    if (auto options = CommandLineOptions::try_parse(arguments, error)) {
+        write_stdout(std::format("try_parse: {}", *options));
+    } else {
+        write_stdout(std::format("try_parse: nullopt ({})\n", error));
+    }
+}
+
+/* Tests `CommandLineOptions::apply` on the options parsed from the arguments after the name of the
+test: with deltas that change options, that set options to the values they already have (which are
+not changes), and that set options left at their defaults, and then with a delta with an error in
+it, which must leave every option as it was. Then tests `CommandLineOptions::try_parse`. */
+void test_apply(int argc, char **argv) {
+    CommandLineOptions options(argc, argv);
+    apply_delta(options, {"--spp", "512", "-n", "4", "--input=scene.txt"});
+    apply_delta(options, {"--seed=8", "-q", "--imagefile", "frame.ppm", "--maxdepth=16"});
+    apply_delta(options, {"-q", "--maxdepth", "16"});
+    apply_delta(options, {"--spp=1024", "--imagefile=other.ppm", "--maxdepth=2", "--nthreads=x"});
+    write_stdout(std::format("max_depth: {}\n", options.max_depth));
+
+    try_parse_arguments({"--spp=64", "-ql", "--input", "other_scene.txt"});
+    try_parse_arguments({"--spp=64", "--nthreads"});
+}
+
+/* Tests arguments that are views of the same characters, as the arguments given to `apply` and
+`try_parse` may be (e.g. when the same string literal is given twice): a boolean option followed by
+a view of the same option is set twice, rather than taking that view as a value after an `=` */
+void test_aliased_arguments(int argc, char **argv) {
+    CommandLineOptions options(argc, argv);
+    constexpr std::string_view short_flag = "-q", long_flag = "--logutil";
+    apply_delta(options, {short_flag, short_flag});
+    apply_delta(options, {long_flag, long_flag, short_flag});
+    try_parse_arguments({short_flag, short_flag, long_flag, long_flag});
+}
+
+/* Prints the number of overrides of `overlay`, and the values of the fields that `test_overlay`
+overrides, each followed by a * if it is overridden */
+void print_overlay(std::string_view description, const OptionsOverlay &overlay) {
+    auto mark = [](bool overridden) { return overridden ? "*" : ""; };
+    write_stdout(std::format(
+        "{}: {} overrides, spp: {}{}, image_file: {}{}, quiet: {}{}, frame: {}{}, "
+        "job_name: {}{}, output_dir: {}{}\n",
+        description, overlay.num_overrides(),
+        overlay.get<&CommandLineOptions::spp>(),
+        mark(overlay.overrides<&CommandLineOptions::spp>()),
+        overlay.get<&CommandLineOptions::image_file>(),
+        mark(overlay.overrides<&CommandLineOptions::image_file>()),
+        overlay.get<&CommandLineOptions::quiet>(),
+        mark(overlay.overrides<&CommandLineOptions::quiet>()),
+        format_optional(overlay.get<&CommandLineOptions::frame>()),
+        mark(overlay.overrides<&CommandLineOptions::frame>()),
+        overlay.get<&CommandLineOptions::job_name>(),
+        mark(overlay.overrides<&CommandLineOptions::job_name>()),
+        format_path(overlay.get<&CommandLineOptions::output_dir>()),
+        mark(overlay.overrides<&CommandLineOptions::output_dir>())
+    ));
+}
+
+/* Tests `OptionsOverlay` over the options parsed from the arguments after the name of the test:
+sets fields of different sizes and alignments (out of field order, so that slots are inserted
+between others), replaces some of them, and copies, moves and flattens the overlay, printing the
+overlays after each step */
+void test_overlay(int argc, char **argv) {
+    CommandLineOptions base(argc, argv);
+    OptionsOverlay overlay(base);
+    print_overlay("empty", overlay);
+
+    overlay.set<&CommandLineOptions::quiet>(true);
+    overlay.set<&CommandLineOptions::output_dir>(std::filesystem::path(u8"renders/overlay/été"));
+    overlay.set<&CommandLineOptions::spp>(64);
+    overlay.set<&CommandLineOptions::image_file>("renders/a-name-too-long-for-the-string.ppm");
+    overlay.set<&CommandLineOptions::frame>(12);
+    overlay.set<&CommandLineOptions::job_name>(InlineString<31>{"overlay-job"});
+    print_overlay("set", overlay);
+
+    overlay.set<&CommandLineOptions::spp>(128);
+    overlay.set<&CommandLineOptions::image_file>("short.ppm");
+    print_overlay("replaced", overlay);
+
+    auto copy = overlay;
+    copy.set<&CommandLineOptions::frame>(std::nullopt);
+    copy.set<&CommandLineOptions::image_file>("copy.ppm");
+    print_overlay("copy, changed", copy);
+    print_overlay("original", overlay);
+
+    OptionsOverlay assigned(base);
+    assigned.set<&CommandLineOptions::spp>(1);
+    assigned = copy;
+    print_overlay("copy assigned", assigned);
+
+    auto moved = std::move(copy);
+    print_overlay("moved", moved);
+    print_overlay("moved from", copy);
+
+    assigned = std::move(moved);
+    print_overlay("move assigned", assigned);
+
+    write_stdout(std::format("flattened: {}", overlay.flatten()));
+    print_overlay("base", OptionsOverlay(overlay.base_options()));
+}
+
+/* Tests `publish_options` and `current_options` (include/optionssnapshot.h). Before anything is
+published, `current_options` parses the arguments of the process, whose first argument (the name of
+this test) is an error. Then the options parsed from the arguments after the name of the test are
+published, and published again with other values while other threads read the current snapshot:
+each snapshot must hold the values it was published with, in its hot fields as in `options`, and
+stay readable after it is replaced, until the replaced snapshots are reclaimed once the readers have
+finished. */
+void test_snapshot(int argc, char **argv) {
+    try {
+        current_options();
+        write_stdout("current_options: no error\n");
+    } catch (const CommandLineOptionsError &error) {
+        write_stdout(std::format("current_options: {}\n", error.what()));
+    }
+
+    CommandLineOptions options(argc, argv);
+    publish_options(options);
+    const auto &first = current_options();
+    write_stdout(std::format(
+        "published: nthreads: {}, spp: {}, seed: {}, quiet: {}, image_file: {}, aligned: {}\n",
+        first.nthreads, first.spp, first.seed, first.quiet, first.options.image_file,
+        reinterpret_cast<std::uintptr_t>(&first) % options_snapshot_alignment == 0
+    ));
+
+    /* Publish snapshots with increasing `spp` while the readers check every snapshot they see */
+    constexpr int num_publications = 1000;
+    std::atomic<bool> consistent = true;
+    {
+        std::vector<std::jthread> readers;
+        for (int i = 0; i < 4; ++i) {
+            readers.emplace_back([&] {
+                int last_spp = 0;
+                while (last_spp < num_publications) {
+                    const auto &snapshot = current_options();
+                    if (snapshot.spp < last_spp || snapshot.spp != snapshot.options.spp ||
+                        snapshot.seed != snapshot.options.seed) {
+                        consistent = false;
+                    }
+                    last_spp = snapshot.spp;
+                }
+            });
+        }
+        for (int spp = 1; spp <= num_publications; ++spp) {
+            options.spp = spp;
+            options.seed = -spp;
+            publish_options(options);
+        }
+    }
+    write_stdout(std::format(
+        "after {} publications: spp: {}, readers saw consistent snapshots: {}\n", num_publications,
+        current_options().spp, consistent.load()
+    ));
+    write_stdout(std::format(
+        "first snapshot after being replaced: spp: {}, image_file: {}\n", first.spp,
+        first.options.image_file
+    ));
+
+    /* No thread reads the replaced snapshots any more, so they can be reclaimed */
+    auto reclaimed = reclaim_retired_snapshots();
+    write_stdout(std::format(
+        "reclaimed: {}, then {}, current spp: {}\n", reclaimed, reclaim_retired_snapshots(),
+        current_options().spp
+    ));
+}
+
+#ifdef CPP_ARGUMENT_PARSER_FORK_SERVER
+/* Tests a round trip through a fork server (see include/forkserver.h), run in a child of this
+process, whose jobs print their options and exit with their number of threads, or throw if they
+are given a seed: a job with valid arguments, a job with an error in its arguments, and a job that
+throws, which both fail with exit status 255, and then another valid job, which must still be run
+by the server (and not by the child of the job that threw). Before the jobs, a client connects to
+the server and sends nothing, so the jobs only run once the server has stopped waiting for that
+client. The `stderr` of the jobs is redirected to `stdout`, so that their errors are printed too. */
+void test_fork_server(int, char **) {
+    char directory[] = "/tmp/cpp_argument_parser_XXXXXX";
+    if (!::mkdtemp(directory)) {
+        write_stdout("Cannot create a directory for the socket\n");
+        return;
+    }
+    auto socket_path = std::string(directory) + "/socket";
+
+    flush_output();
+    auto server = ::fork();
+    if (server == 0) {
+        run_fork_server(socket_path.c_str(), [](const CommandLineOptions &options) {
+            if (options.seed != 0) {
+                throw std::runtime_error(std::format("cannot render with seed {}", options.seed));
+            }
+            write_stdout(std::format("Job options: {}", options));
+            return options.nthreads;
+        });
+        ::_exit(1);
+    }
+
+    /* Connect the client that sends nothing, once the server is listening */
+    sockaddr_un address = {};
+    address.sun_family = AF_UNIX;
+    std::memcpy(address.sun_path, socket_path.c_str(), socket_path.size() + 1);
+    int stalled_client = -1;
+    for (int attempt = 0; attempt < 500 && stalled_client < 0; ++attempt) {
+        stalled_client = ::socket(AF_UNIX, SOCK_STREAM, 0);
+        if (::connect(
+                stalled_client, reinterpret_cast<const sockaddr *>(&address), sizeof(address)
+            ) < 0) {
+            ::close(stalled_client);
+            stalled_client = -1;
+            ::usleep(10'000);
+        }
+    }
+    write_stdout(std::format("Stalled client connected: {}\n", stalled_client >= 0));
+
+    const std::vector<std::string_view> jobs[] = {
+        {"--nthreads=3", "--spp", "8", "-q"},
+        {"--spp=8", "--nthreads=many"},
+        {"--nthreads=2", "--seed=13"},
+        {"--nthreads=5", "-q"},
+    };
+    int saved_stderr = ::dup(STDERR_FILENO);
+    ::dup2(STDOUT_FILENO, STDERR_FILENO);
+    for (const auto &arguments : jobs) {
+        auto status = run_fork_server_job(socket_path.c_str(), arguments);
+        write_stdout(std::format("Exit status: {}\n", status));
+        flush_output();
+    }
+    ::dup2(saved_stderr, STDERR_FILENO);
+    ::close(saved_stderr);
+
+    ::close(stalled_client);
+    ::kill(server, SIGTERM);
+    ::waitpid(server, nullptr, 0);
+    ::unlink(socket_path.c_str());
+    ::rmdir(directory);
+}
+#endif
+
+#ifdef __GLIBC__
+/* The results of parsing one command line with `getopt_long` or `cap_getopt_long`: every value
+returned, with `optarg`, `optind` and the long option index after it, then the arguments in the
+order they were left in (after permutation), and what was written to `stderr` */
+struct GetoptRun {
+    std::string results;
+    std::string error_output;
+};
+
+/* Calls `parse_next` until it returns -1, recording each result in a `GetoptRun`, with `stderr`
+redirected to a temporary file, so that the error messages are compared too */
+auto run_getopt(
+    std::vector<char *> argv,
+    auto parse_next,
+    char *const &optarg,
+    const int &optind,
+    const int &flag
+) -> GetoptRun {
+    GetoptRun run;
+    flush_output();
+    std::fflush(stderr);
+    auto saved_stderr = ::dup(STDERR_FILENO);
+    auto error_file = std::tmpfile();
+    ::dup2(::fileno(error_file), STDERR_FILENO);
+
+    auto argc = static_cast<int>(argv.size());
+    argv.push_back(nullptr);
+    for (int i = 0; i < 64; ++i) {
+        int longindex = -1;
+        auto result = parse_next(argc, argv.data(), &longindex);
+        run.results += std::format(
+            "{} optarg={} optind={} longindex={} flag={}\n", result,
+            optarg ? optarg : "(null)", optind, longindex, flag
+        );
+        if (result == -1) {
+            break;
+        }
+    }
+    for (int i = 0; i < argc; ++i) {
+        run.results += std::format("{}{}", i == 0 ? "argv:" : " ", argv[i]);
+    }
+
+    flush_output();
+    std::fflush(stderr);
+    ::dup2(saved_stderr, STDERR_FILENO);
+    ::close(saved_stderr);
+    std::rewind(error_file);
+    for (int c; (c = std::fgetc(error_file)) != EOF;) {
+        run.error_output.push_back(static_cast<char>(c));
+    }
+    std::fclose(error_file);
+    return run;
+}
+
+/* Tests `cap_getopt_long` (include/getopt_compat.h) against glibc's `getopt_long` on a fixed-seed
+sample of random command lines, built from arguments that reach each of its cases (clusters, short
+and long options with required, optional and no values, abbreviations, ambiguous and unknown
+options, `--`, and non-options to permute), with each kind of `optstring`. Every difference in the
+values returned, `optarg`, `optind`, the long option index, the flag set, the permuted arguments,
+or `stderr` is a mismatch; the first few are printed in full. */
+void test_getopt(int, char **) {
+    static int glibc_flag, cap_flag;
+    const char *optstrings[] = {"ab:c::qv", "+ab:c::qv", "-ab:c::qv", ":ab:c::qv", "+:ab:qv"};
+    const option glibc_options[] = {
+        {"alpha", no_argument, nullptr, 'a'},
+        {"beta", required_argument, nullptr, 'b'},
+        {"gamma", optional_argument, nullptr, 'c'},
+        {"gammaray", no_argument, &glibc_flag, 7},
+        {"delta", required_argument, nullptr, 'd'},
+        {"verbose", no_argument, nullptr, 'v'},
+        {nullptr, 0, nullptr, 0},
+    };
+    const cap_option cap_options[] = {
+        {"alpha", CAP_NO_ARGUMENT, nullptr, 'a'},
+        {"beta", CAP_REQUIRED_ARGUMENT, nullptr, 'b'},
+        {"gamma", CAP_OPTIONAL_ARGUMENT, nullptr, 'c'},
+        {"gammaray", CAP_NO_ARGUMENT, &cap_flag, 7},
+        {"delta", CAP_REQUIRED_ARGUMENT, nullptr, 'd'},
+        {"verbose", CAP_NO_ARGUMENT, nullptr, 'v'},
+        {nullptr, 0, nullptr, 0},
+    };
+    const char *arguments[] = {
+        "-a", "-b", "-bvalue", "-c", "-cvalue", "-qv", "-qbx", "-z", "-qz", "-", "--",
+        "--alpha", "--alpha=1", "--beta", "--beta=value", "--gamma", "--gamma=value", "--gammaray",
+        "--gam", "--ga", "--del", "--delta", "--verb", "--unknown", "--unknown=1", "file",
+        "other_file", "value",
+    };
+
+    ::unsetenv("POSIXLY_CORRECT");
+    std::mt19937 rng(1);
+    int num_mismatches = 0;
+    const int num_samples = 4000;
+    for (int sample = 0; sample < num_samples; ++sample) {
+        auto optstring = optstrings[rng() % std::size(optstrings)];
+        std::vector<char *> argv = {const_cast<char *>("prog")};
+        for (auto num_arguments = rng() % 7; num_arguments > 0; --num_arguments) {
+            argv.push_back(const_cast<char *>(arguments[rng() % std::size(arguments)]));
+        }
+
+        glibc_flag = cap_flag = 0;
+        optind = 0;
+        auto glibc_run = run_getopt(argv, [&](int argc, char **argv, int *longindex) {
+            return getopt_long(argc, argv, optstring, glibc_options, longindex);
+        }, optarg, optind, glibc_flag);
+        cap_optind = 0;
+        auto cap_run = run_getopt(argv, [&](int argc, char **argv, int *longindex) {
+            return cap_getopt_long(argc, argv, optstring, cap_options, longindex);
+        }, cap_optarg, cap_optind, cap_flag);
+
+        if (glibc_run.results != cap_run.results ||
+            glibc_run.error_output != cap_run.error_output) {
+            if (++num_mismatches <= 3) {
+                write_stdout(std::format(
+                    "Mismatch with optstring {}:\nglibc:\n{}\n{}cap:\n{}\n{}", optstring,
+                    glibc_run.results, glibc_run.error_output, cap_run.results,
+                    cap_run.error_output
+                ));
+            }
+        }
+    }
+    write_stdout(std::format(
+        "getopt_long: {} mismatches in {} command lines\n", num_mismatches, num_samples
+    ));
+}
+#endif
+
+}
+
+int main(int argc, char **argv)
+{
+    static constexpr std::pair<std::string_view, void (*)(int, char **)> tests[] = {
+        {"utf16", test_utf16},
+        {"empty_argv", test_empty_argv},
+        {"options", test_options},
+        {"loose_names", test_loose_names},
+        {"parallel", test_parallel},
+        {"parse_stats", test_parse_stats},
+        {"apply", test_apply},
+        {"aliased_arguments", test_aliased_arguments},
+        {"output", test_output},
+        {"overlay", test_overlay},
+        {"snapshot", test_snapshot},
+#ifdef __GLIBC__
+        {"getopt", test_getopt},
+#endif
+#ifdef CPP_ARGUMENT_PARSER_FORK_SERVER
+        {"fork_server", test_fork_server},
+#endif
+    };
+
+    auto name = std::string_view(argc > 1 ? argv[1] : "");
+    for (auto [test_name, test] : tests) {
+        if (test_name == name) {
+            test(argc - 1, argv + 1);
+            return 0;
+        }
+    }
+    write_stderr(std::format("Unknown test {}\n", name));
+    return 1;
+}